@@ -1,24 +1,58 @@
 #pragma once
 
 #include "base.h"
+#include "colors.h"
+#include "screen_kernels.h"
 #include <any>
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <charconv>
 #include <cstddef>
 #include <cstring>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 // TODO : add assert
 
 namespace lot {
 
+// Addition data is stored in a hash map keyed by position, suitable for genuinely sparse data
+template <typename T = std::any>
+struct sparse_addition
+{
+    using value_type = T;
+};
+
+/**
+ * @brief Addition data is stored in a dense array parallel to the char grid, no allocation per cell
+ *
+ * @tparam T Type of addition data, must be default constructible
+ * @tparam is_track_presence Whether a presence bitmap records which cells have addition data,
+ * if false every cell always has addition data and clearing resets it to T{}
+ */
+template <typename T, bool is_track_presence = true>
+struct dense_addition
+{
+    static_assert(std::is_default_constructible_v<T>, "T must be default constructible!");
+    using value_type = T;
+};
+
 namespace detail {
 
-    template <std::uint32_t width, std::uint32_t height, bool is_add_addition>
-    struct add_addition_data
+    template <std::uint32_t width, std::uint32_t height, bool is_add_addition, typename AdditionStorage>
+    struct add_addition_data;
+
+    template <std::uint32_t width, std::uint32_t height, typename T>
+    struct add_addition_data<width, height, true, sparse_addition<T>>
     {
         [[nodiscard]] const auto& get_addition_data_map() const noexcept
         {
@@ -36,7 +70,7 @@ namespace detail {
             return (addition_data_.find(get_key_from_pos(pos_x, pos_y)) != addition_data_.end());
         }
 
-        [[nodiscard]] std::any& get_addition_data(std::uint32_t pos_x, std::uint32_t pos_y)
+        [[nodiscard]] T& get_addition_data(std::uint32_t pos_x, std::uint32_t pos_y)
         {
             lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
             auto iter = addition_data_.find(get_key_from_pos(pos_x, pos_y));
@@ -58,6 +92,17 @@ namespace detail {
             return std::pair { static_cast<std::uint32_t>((key << 32) >> 32), static_cast<std::uint32_t>(key >> 32) };
         }
 
+        // Call `func(pos_x, pos_y, addition_data)` for every cell that has addition data
+        template <typename Func>
+        void for_each_addition_data(Func&& func)
+        {
+            for (auto&& [key, value] : addition_data_)
+            {
+                auto [pos_x, pos_y] = get_pos_from_key(key);
+                func(pos_x, pos_y, value);
+            }
+        }
+
         [[nodiscard]] auto begin() const noexcept
         {
             return addition_data_.begin();
@@ -88,21 +133,511 @@ namespace detail {
             return addition_data_.end();
         }
 
+    protected:
+        void store_addition_data(std::uint32_t pos_x, std::uint32_t pos_y, const T& addition_data)
+        {
+            addition_data_[get_key_from_pos(pos_x, pos_y)] = addition_data;
+        }
+
+        void erase_addition_data(std::uint32_t pos_x, std::uint32_t pos_y)
+        {
+            addition_data_.erase(get_key_from_pos(pos_x, pos_y));
+        }
+
+        void erase_all_addition_data() noexcept
+        {
+            addition_data_.clear();
+        }
+
+        void fill_addition_data(const T& addition_data)
+        {
+            addition_data_.reserve(std::size_t(width) * height);
+            for (std::uint32_t pos_y = 0; pos_y < height; pos_y++)
+                for (std::uint32_t pos_x = 0; pos_x < width; pos_x++)
+                    store_addition_data(pos_x, pos_y, addition_data);
+        }
+
+        void fill_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, const T& addition_data)
+        {
+            for (std::uint32_t row = pos_y; row < pos_y + rect_height; row++)
+                for (std::uint32_t columu = pos_x; columu < pos_x + rect_width; columu++)
+                    store_addition_data(columu, row, addition_data);
+        }
+
+        void erase_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height)
+        {
+            // Visit whichever is smaller, the cells of the rect or the stored entries
+            if (std::size_t(rect_width) * rect_height < addition_data_.size())
+            {
+                for (std::uint32_t row = pos_y; row < pos_y + rect_height; row++)
+                    for (std::uint32_t columu = pos_x; columu < pos_x + rect_width; columu++)
+                        erase_addition_data(columu, row);
+            } else {
+                std::erase_if(addition_data_, [&](const auto& item) {
+                    auto [item_x, item_y] = get_pos_from_key(item.first);
+                    return item_x >= pos_x && item_x < pos_x + rect_width && item_y >= pos_y && item_y < pos_y + rect_height;
+                });
+            }
+        }
+
+        void scroll_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, std::int64_t offset_x, std::int64_t offset_y)
+        {
+            std::vector<std::pair<std::uint64_t, T>> moved_list;
+            for (auto iter = addition_data_.begin(); iter != addition_data_.end();)
+            {
+                auto [item_x, item_y] = get_pos_from_key(iter->first);
+                if (item_x < pos_x || item_x >= pos_x + rect_width || item_y < pos_y || item_y >= pos_y + rect_height)
+                {
+                    ++iter;
+                    continue;
+                }
+
+                const std::int64_t new_x = std::int64_t(item_x) + offset_x;
+                const std::int64_t new_y = std::int64_t(item_y) + offset_y;
+                if (new_x >= pos_x && new_x < std::int64_t(pos_x) + rect_width && new_y >= pos_y && new_y < std::int64_t(pos_y) + rect_height)
+                    moved_list.emplace_back(get_key_from_pos(static_cast<std::uint32_t>(new_x), static_cast<std::uint32_t>(new_y)), std::move(iter->second));
+                iter = addition_data_.erase(iter);
+            }
+
+            for (auto&& [key, value] : moved_list)
+                addition_data_.insert_or_assign(key, std::move(value));
+        }
+
+        template <std::uint32_t src_width, std::uint32_t src_height>
+        void copy_addition_data_rect(const add_addition_data<src_width, src_height, true, sparse_addition<T>>& src, std::uint32_t src_x, std::uint32_t src_y, std::uint32_t rect_width, std::uint32_t rect_height, std::uint32_t dst_x, std::uint32_t dst_y)
+        {
+            for (std::uint32_t row = 0; row < rect_height; row++)
+            {
+                for (std::uint32_t columu = 0; columu < rect_width; columu++)
+                {
+                    auto iter = src.addition_data_.find(src.get_key_from_pos(src_x + columu, src_y + row));
+                    if (iter != src.addition_data_.end())
+                        store_addition_data(dst_x + columu, dst_y + row, iter->second);
+                    else
+                        erase_addition_data(dst_x + columu, dst_y + row);
+                }
+            }
+        }
+
     private:
-        std::unordered_map<std::uint64_t, std::any> addition_data_;
+        template <std::uint32_t, std::uint32_t, bool, typename>
+        friend struct add_addition_data;
+
+        std::unordered_map<std::uint64_t, T> addition_data_;
+    };
+
+    template <std::uint32_t width, std::uint32_t height, typename T, bool is_track_presence>
+    struct add_addition_data<width, height, true, dense_addition<T, is_track_presence>>
+    {
+        static constexpr std::size_t cell_count = std::size_t(width) * height;
+
+        add_addition_data() : addition_data_ptr_(std::make_unique<std::array<T, cell_count>>())
+        {
+            if constexpr (is_track_presence)
+                presence_bits_ptr_ = std::make_unique<std::array<std::uint64_t, (cell_count + 63) / 64>>();
+        }
+
+        // The dense plane, row-major and parallel to the char grid
+        [[nodiscard]] T* get_addition_data_plane() noexcept
+        {
+            return addition_data_ptr_->data();
+        }
+
+        [[nodiscard]] const T* get_addition_data_plane() const noexcept
+        {
+            return addition_data_ptr_->data();
+        }
+
+        // The presence bitmap, bit `index % 64` of word `index / 64` is set when the cell at `index` has addition data
+        [[nodiscard]] std::uint64_t* get_presence_bits() noexcept requires(is_track_presence)
+        {
+            return presence_bits_ptr_->data();
+        }
+
+        [[nodiscard]] const std::uint64_t* get_presence_bits() const noexcept requires(is_track_presence)
+        {
+            return presence_bits_ptr_->data();
+        }
+
+        [[nodiscard]] bool has_addition_data(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+        {
+            lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
+            if constexpr (is_track_presence)
+            {
+                const std::size_t index = get_index_from_pos(pos_x, pos_y);
+                return ((*presence_bits_ptr_)[index / 64] >> (index % 64) & 1U) != 0;
+            } else {
+                return true;
+            }
+        }
+
+        [[nodiscard]] T& get_addition_data(std::uint32_t pos_x, std::uint32_t pos_y)
+        {
+            lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
+            if (has_addition_data(pos_x, pos_y))
+                return (*addition_data_ptr_)[get_index_from_pos(pos_x, pos_y)];
+
+            throw std::runtime_error("ascii_screen get_addition_data fails : no addition_data in " + std::to_string(pos_x) + " ," + std::to_string(pos_y));
+        }
+
+        static inline std::size_t get_index_from_pos(std::uint32_t pos_x, std::uint32_t pos_y) noexcept
+        {
+            lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
+            return std::size_t(pos_y) * width + pos_x;
+        }
+
+        // Call `func(pos_x, pos_y, addition_data)` for every cell that has addition data
+        template <typename Func>
+        void for_each_addition_data(Func&& func)
+        {
+            if constexpr (is_track_presence)
+            {
+                for (std::size_t word_index = 0; word_index < presence_bits_ptr_->size(); ++word_index)
+                {
+                    for (std::uint64_t bits = (*presence_bits_ptr_)[word_index]; bits != 0; bits &= bits - 1)
+                    {
+                        const std::size_t index = word_index * 64 + std::countr_zero(bits);
+                        func(static_cast<std::uint32_t>(index % width), static_cast<std::uint32_t>(index / width), (*addition_data_ptr_)[index]);
+                    }
+                }
+            } else {
+                for (std::size_t index = 0; index < cell_count; ++index)
+                    func(static_cast<std::uint32_t>(index % width), static_cast<std::uint32_t>(index / width), (*addition_data_ptr_)[index]);
+            }
+        }
+
+    protected:
+        void store_addition_data(std::uint32_t pos_x, std::uint32_t pos_y, const T& addition_data)
+        {
+            const std::size_t index = get_index_from_pos(pos_x, pos_y);
+            (*addition_data_ptr_)[index] = addition_data;
+            if constexpr (is_track_presence)
+                (*presence_bits_ptr_)[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
+
+        void erase_addition_data(std::uint32_t pos_x, std::uint32_t pos_y)
+        {
+            const std::size_t index = get_index_from_pos(pos_x, pos_y);
+            if constexpr (is_track_presence)
+                (*presence_bits_ptr_)[index / 64] &= ~(std::uint64_t(1) << (index % 64));
+            else
+                (*addition_data_ptr_)[index] = T {};
+        }
+
+        void erase_all_addition_data()
+        {
+            if constexpr (is_track_presence)
+                presence_bits_ptr_->fill(0);
+            else
+                addition_data_ptr_->fill(T {});
+        }
+
+        void fill_addition_data(const T& addition_data)
+        {
+            addition_data_ptr_->fill(addition_data);
+            if constexpr (is_track_presence)
+            {
+                presence_bits_ptr_->fill(~std::uint64_t(0));
+                if constexpr (cell_count % 64 != 0)
+                    presence_bits_ptr_->back() = (std::uint64_t(1) << (cell_count % 64)) - 1;
+            }
+        }
+
+        void fill_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, const T& addition_data)
+        {
+            fill_rect(get_addition_data_plane(), width, pos_x, pos_y, rect_width, rect_height, addition_data);
+            if constexpr (is_track_presence)
+                for (std::uint32_t row = pos_y; row < pos_y + rect_height; row++)
+                    fill_bits(presence_bits_ptr_->data(), get_index_from_pos(pos_x, row), rect_width, true);
+        }
+
+        void erase_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height)
+        {
+            if constexpr (is_track_presence)
+            {
+                for (std::uint32_t row = pos_y; row < pos_y + rect_height; row++)
+                    fill_bits(presence_bits_ptr_->data(), get_index_from_pos(pos_x, row), rect_width, false);
+            } else {
+                fill_rect(get_addition_data_plane(), width, pos_x, pos_y, rect_width, rect_height, T {});
+            }
+        }
+
+        void scroll_addition_data_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, std::int64_t offset_x, std::int64_t offset_y)
+        {
+            scroll_rect(get_addition_data_plane(), width, pos_x, pos_y, rect_width, rect_height, offset_x, offset_y, T {});
+            if constexpr (is_track_presence)
+            {
+                auto* bits = presence_bits_ptr_->data();
+                for_each_scroll_span(
+                    pos_x, pos_y, rect_width, rect_height, offset_x, offset_y,
+                    [&](std::uint32_t dst_x, std::uint32_t dst_y, std::uint32_t src_x, std::uint32_t src_y, std::uint32_t count) {
+                        move_bits(bits, get_index_from_pos(dst_x, dst_y), get_index_from_pos(src_x, src_y), count);
+                    },
+                    [&](std::uint32_t clear_x, std::uint32_t clear_y, std::uint32_t count) {
+                        fill_bits(bits, get_index_from_pos(clear_x, clear_y), count, false);
+                    });
+            }
+        }
+
+        template <std::uint32_t src_width, std::uint32_t src_height>
+        void copy_addition_data_rect(const add_addition_data<src_width, src_height, true, dense_addition<T, is_track_presence>>& src, std::uint32_t src_x, std::uint32_t src_y, std::uint32_t rect_width, std::uint32_t rect_height, std::uint32_t dst_x, std::uint32_t dst_y)
+        {
+            copy_rect(get_addition_data_plane() + get_index_from_pos(dst_x, dst_y), width, src.get_addition_data_plane() + src.get_index_from_pos(src_x, src_y), src_width, rect_width, rect_height);
+            if constexpr (is_track_presence)
+                for (std::uint32_t row = 0; row < rect_height; row++)
+                    for (std::uint32_t columu = 0; columu < rect_width; columu++)
+                        set_bit(presence_bits_ptr_->data(), get_index_from_pos(dst_x + columu, dst_y + row), src.has_addition_data(src_x + columu, src_y + row));
+        }
+
+    private:
+        std::unique_ptr<std::array<T, cell_count>> addition_data_ptr_;
+        std::unique_ptr<std::array<std::uint64_t, (cell_count + 63) / 64>> presence_bits_ptr_;
+    };
+
+    template <std::uint32_t width, std::uint32_t height, typename AdditionStorage>
+    struct add_addition_data<width, height, false, AdditionStorage>
+    {
+    };
+
+    /**
+     * @brief Record which cells were touched, a bitmap of dirty rows plus the [min, max) columu bounds of every dirty row
+     */
+    template <std::uint32_t width, std::uint32_t height, bool is_track_dirty>
+    struct track_dirty_region
+    {
+        track_dirty_region() { clear_dirty(); }
+
+        [[nodiscard]] bool is_dirty() const noexcept
+        {
+            return std::any_of(dirty_row_bits_.cbegin(), dirty_row_bits_.cend(), [](std::uint64_t bits) { return bits != 0; });
+        }
+
+        [[nodiscard]] bool is_row_dirty(std::uint32_t row) const noexcept
+        {
+            lo_assert(row < height);
+            return (dirty_row_bits_[row / 64] >> (row % 64) & 1U) != 0;
+        }
+
+        // Return [min, max) of dirty columus in the row, {0, 0} if the row is clean
+        [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> get_dirty_columus(std::uint32_t row) const noexcept
+        {
+            lo_assert(row < height);
+            if (!is_row_dirty(row))
+                return { 0, 0 };
+            return dirty_bounds_[row];
+        }
+
+        // Call `func(row, start, end)` for every dirty row in ascending order
+        template <typename Func>
+        void for_each_dirty_row(Func&& func) const
+        {
+            for (std::size_t word_index = 0; word_index < dirty_row_bits_.size(); ++word_index)
+            {
+                for (std::uint64_t bits = dirty_row_bits_[word_index]; bits != 0; bits &= bits - 1)
+                {
+                    const auto row = static_cast<std::uint32_t>(word_index * 64 + std::countr_zero(bits));
+                    func(row, dirty_bounds_[row].first, dirty_bounds_[row].second);
+                }
+            }
+        }
+
+        void clear_dirty() noexcept
+        {
+            dirty_row_bits_.fill(0);
+            ++dirty_epoch_;
+        }
+
+        // Incremented by every `clear_dirty`, a consumer of the dirty region can see that someone else cleared it
+        [[nodiscard]] std::uint64_t get_dirty_epoch() const noexcept
+        {
+            return dirty_epoch_;
+        }
+
+        void mark_dirty(std::uint32_t pos_x, std::uint32_t pos_y) noexcept
+        {
+            mark_dirty_row(pos_y, pos_x, pos_x + 1);
+        }
+
+        void mark_dirty_row(std::uint32_t row, std::uint32_t start, std::uint32_t end) noexcept
+        {
+            lo_assert(row < height && start <= end && end <= width);
+            if (start == end)
+                return;
+
+            auto&& bounds = dirty_bounds_[row];
+            if (is_row_dirty(row))
+            {
+                bounds.first = (std::min)(bounds.first, start);
+                bounds.second = (std::max)(bounds.second, end);
+            } else {
+                bounds = { start, end };
+                dirty_row_bits_[row / 64] |= std::uint64_t(1) << (row % 64);
+            }
+        }
+
+        void mark_dirty_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height) noexcept
+        {
+            for (std::uint32_t row = pos_y; row < pos_y + rect_height; ++row)
+                mark_dirty_row(row, pos_x, pos_x + rect_width);
+        }
+
+        void mark_dirty() noexcept
+        {
+            mark_dirty_rect(0, 0, width, height);
+        }
+
+    private:
+        std::array<std::uint64_t, (height + 63) / 64> dirty_row_bits_;
+        std::array<std::pair<std::uint32_t, std::uint32_t>, height> dirty_bounds_;
+        std::uint64_t dirty_epoch_ = 0;
+    };
+
+    template <std::uint32_t width, std::uint32_t height>
+    struct track_dirty_region<width, height, false>
+    {
+    };
+
+    template <std::uint32_t width, std::uint32_t height, bool is_add_attribute>
+    struct add_attribute_plane
+    {
+        static constexpr std::size_t cell_count = std::size_t(width) * height;
+
+        add_attribute_plane() : attribute_ptr_(std::make_unique<std::array<text_attribute, cell_count>>()) { }
+
+        // The attribute plane, row-major and parallel to the char grid
+        [[nodiscard]] text_attribute* get_attribute_plane() noexcept
+        {
+            return attribute_ptr_->data();
+        }
+
+        [[nodiscard]] const text_attribute* get_attribute_plane() const noexcept
+        {
+            return attribute_ptr_->data();
+        }
+
+        [[nodiscard]] text_attribute get_attribute(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+        {
+            lo_assert(pos_x < width && pos_y < height);
+            return (*attribute_ptr_)[std::size_t(pos_y) * width + pos_x];
+        }
+
+    private:
+        std::unique_ptr<std::array<text_attribute, cell_count>> attribute_ptr_;
     };
 
     template <std::uint32_t width, std::uint32_t height>
-    struct add_addition_data<width, height, false>
+    struct add_attribute_plane<width, height, false>
     {
     };
 
+    // Append `count` characters, an SGR sequence is only emitted where the attribute differs from `current`
+    inline void append_attribute_span(std::string& buffer, const char* chars, const text_attribute* attributes, std::size_t count, text_attribute& current)
+    {
+        std::size_t run_start = 0;
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            if (attributes[index] == current)
+                continue;
+
+            buffer.append(chars + run_start, index - run_start);
+            current = attributes[index];
+            current.append_sgr(buffer);
+            run_start = index;
+        }
+        buffer.append(chars + run_start, count - run_start);
+    }
+
+    // Append every row followed by '\n', the terminal is reset before each newline so colors don't bleed
+    inline void append_attribute_frame(std::string& buffer, const char* chars, const text_attribute* attributes, std::uint32_t width, std::uint32_t height)
+    {
+        buffer.clear();
+        for (std::uint32_t row = 0; row < height; ++row)
+        {
+            text_attribute current {};
+            const std::size_t offset = std::size_t(row) * width;
+            append_attribute_span(buffer, chars + offset, attributes + offset, width, current);
+            if (!current.is_default())
+                text_attribute {}.append_sgr(buffer);
+            buffer.push_back('\n');
+        }
+    }
+
+    /**
+     * @brief Compare two rows and call `func(start, end)` for every span [start, end) that differs,
+     * two spans separated by less than `merge_gap` equal cells are merged into one
+     *
+     * @param is_changed Return whether the cell at the given index differs
+     */
+    template <typename ChangedFunc, typename Func>
+    void for_each_changed_span(std::uint32_t length, std::uint32_t merge_gap, ChangedFunc&& is_changed, Func&& func)
+    {
+        std::uint32_t pos_x = 0;
+        while (pos_x < length)
+        {
+            while (pos_x < length && !is_changed(pos_x))
+                ++pos_x;
+
+            if (pos_x == length)
+                break;
+
+            std::uint32_t start = pos_x;
+            std::uint32_t end = pos_x + 1;
+            std::uint32_t equal_count = 0;
+            for (pos_x = end; pos_x < length && equal_count < merge_gap; ++pos_x)
+            {
+                if (is_changed(pos_x))
+                {
+                    end = pos_x + 1;
+                    equal_count = 0;
+                } else {
+                    ++equal_count;
+                }
+            }
+
+            func(start, end);
+            pos_x = end;
+        }
+    }
+
+    template <typename Func>
+    void for_each_changed_span(const char* old_row, const char* new_row, std::uint32_t length, std::uint32_t merge_gap, Func&& func)
+    {
+        for_each_changed_span(
+            length, merge_gap, [&](std::uint32_t pos_x) { return old_row[pos_x] != new_row[pos_x]; }, std::forward<Func>(func));
+    }
+
+    // Append "\033[row;columuH", both are 0-based
+    inline void append_cursor_move(std::string& buffer, std::uint32_t row, std::uint32_t columu)
+    {
+        char temp[32] = "\033[";
+        char* ptr = std::to_chars(temp + 2, std::end(temp), row + 1).ptr;
+        *ptr++ = ';';
+        ptr = std::to_chars(ptr, std::end(temp), columu + 1).ptr;
+        *ptr++ = 'H';
+        buffer.append(temp, ptr);
+    }
+
 } // namespace detail
 
-template <std::uint32_t width, std::uint32_t height, bool is_add_addition = false>
-class ascii_screen : public detail::add_addition_data<width, height, is_add_addition>
+/**
+ * @brief A fixed size character screen
+ *
+ * @tparam width Width of the screen
+ * @tparam height Height of the screen
+ * @tparam is_add_addition Whether every cell can carry addition data
+ * @tparam is_track_dirty Whether mutators record the touched region (see detail::track_dirty_region),
+ * writes through `data()` or `container()` are not recorded
+ * @tparam AdditionStorage How addition data is stored, sparse_addition<T> or dense_addition<T>
+ * @tparam is_add_attribute Whether every cell has a text_attribute (colors and styles) that `show` emits as SGR sequences
+ */
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition = false, bool is_track_dirty = false, typename AdditionStorage = sparse_addition<>, bool is_add_attribute = false>
+class LOT_EMPTY_BASES ascii_screen : public detail::add_addition_data<width, height, is_add_addition, AdditionStorage>,
+                                     public detail::track_dirty_region<width, height, is_track_dirty>,
+                                     public detail::add_attribute_plane<width, height, is_add_attribute>
 {
 public:
+    using addition_type = typename AdditionStorage::value_type;
+
     static constexpr char empty_char = ' ';
 
     ascii_screen() : screen_char_ptr_(std::make_unique<std::array<std::array<char, width>, height>>()) { clear(); }
@@ -114,7 +649,7 @@ public:
 
     [[nodiscard]] constexpr const char* data() const noexcept
     {
-        return screen_char_ptr_->data();
+        return reinterpret_cast<const char*>(screen_char_ptr_->data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
     }
 
     [[nodiscard]] constexpr auto size() const noexcept
@@ -135,9 +670,9 @@ public:
     ascii_screen& clear()
     {
         if constexpr (is_add_addition)
-            for (std::uint32_t pos_y = 0; pos_y < height; pos_y++)
-                for (std::uint32_t pos_x = 0; pos_x < width; pos_x++)
-                    clear_addition_data(pos_x, pos_y);
+            this->erase_all_addition_data();
+        if constexpr (is_add_attribute)
+            std::fill_n(this->get_attribute_plane(), size(), text_attribute {});
 
         return set(empty_char);
     }
@@ -147,6 +682,8 @@ public:
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
         if constexpr (is_add_addition)
             clear_addition_data(pos_x, pos_y);
+        if constexpr (is_add_attribute)
+            set_attribute(pos_x, pos_y, text_attribute {});
 
         return set(pos_x, pos_y, empty_char);
     }
@@ -154,7 +691,9 @@ public:
     ascii_screen& clear_addition_data(std::uint32_t pos_x, std::uint32_t pos_y) requires(is_add_addition)
     {
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
-        this->get_addition_data_map().erase(this->get_key_from_pos(pos_x, pos_y));
+        this->erase_addition_data(pos_x, pos_y);
+        if constexpr (is_track_dirty)
+            this->mark_dirty(pos_x, pos_y);
         return *this;
     }
 
@@ -165,6 +704,8 @@ public:
         if constexpr (is_add_addition)
             for (std::uint32_t pos_x = start; pos_x < end; pos_x++)
                 clear_addition_data(pos_x, row);
+        if constexpr (is_add_attribute)
+            set_attribute_rect(start, row, end - start, 1, text_attribute {});
 
         return set_row(row, empty_char, start, end);
     }
@@ -176,6 +717,8 @@ public:
         if constexpr (is_add_addition)
             for (std::uint32_t pos_y = start; pos_y < end; pos_y++)
                 clear_addition_data(columu, pos_y);
+        if constexpr (is_add_attribute)
+            set_attribute_rect(columu, start, 1, end - start, text_attribute {});
 
         return set_columu(columu, empty_char, start, end);
     }
@@ -184,17 +727,21 @@ public:
     {
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
         screen_char_ptr_->at(pos_y).at(pos_x) = new_character;
+        if constexpr (is_track_dirty)
+            this->mark_dirty(pos_x, pos_y);
         return *this;
     }
 
-    ascii_screen& set_addition_data(std::uint32_t pos_x, std::uint32_t pos_y, const std::any& addition_data) requires(is_add_addition)
+    ascii_screen& set_addition_data(std::uint32_t pos_x, std::uint32_t pos_y, const addition_type& addition_data) requires(is_add_addition)
     {
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
-        this->get_addition_data_map()[this->get_key_from_pos(pos_x, pos_y)] = addition_data;
+        this->store_addition_data(pos_x, pos_y, addition_data);
+        if constexpr (is_track_dirty)
+            this->mark_dirty(pos_x, pos_y);
         return *this;
     }
 
-    ascii_screen& set(std::uint32_t pos_x, std::uint32_t pos_y, char new_character, const std::any& addition_data) requires(is_add_addition)
+    ascii_screen& set(std::uint32_t pos_x, std::uint32_t pos_y, char new_character, const addition_type& addition_data) requires(is_add_addition)
     {
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
         set(pos_x, pos_y, new_character);
@@ -205,18 +752,20 @@ public:
     ascii_screen& set(char new_character)
     {
         std::memset(data(), new_character, size());
+        if constexpr (is_track_dirty)
+            this->mark_dirty();
         return *this;
     }
 
-    ascii_screen& set_addition_data(const std::any& addition_data) requires(is_add_addition)
+    ascii_screen& set_addition_data(const addition_type& addition_data) requires(is_add_addition)
     {
-        for (std::uint32_t pos_y = 0; pos_y < height; pos_y++)
-            for (std::uint32_t pos_x = 0; pos_x < width; pos_x++)
-                set_addition_data(pos_x, pos_y, addition_data);
+        this->fill_addition_data(addition_data);
+        if constexpr (is_track_dirty)
+            this->mark_dirty();
         return *this;
     }
 
-    ascii_screen& set(char new_character, const std::any& addition_data) requires(is_add_addition)
+    ascii_screen& set(char new_character, const addition_type& addition_data) requires(is_add_addition)
     {
         set(new_character);
         set_addition_data(addition_data);
@@ -228,11 +777,13 @@ public:
         lo_assert(row >= 0 && row < height);
         lo_assert(start >= 0 && start <= width && start <= end && end <= width);
         auto&& row_array = container().at(row);
-        std::memset(row_array.data() + start, new_character, end);
+        std::memset(row_array.data() + start, new_character, end - start);
+        if constexpr (is_track_dirty)
+            this->mark_dirty_row(row, start, end);
         return *this;
     }
 
-    ascii_screen& set_addition_data_row(std::uint32_t row, const std::any& addition_data, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_addition)
+    ascii_screen& set_addition_data_row(std::uint32_t row, const addition_type& addition_data, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_addition)
     {
         lo_assert(row >= 0 && row < height);
         lo_assert(start >= 0 && start <= width && start <= end && end <= width);
@@ -241,7 +792,7 @@ public:
         return *this;
     }
 
-    ascii_screen& set_row(std::uint32_t row, char new_character, const std::any& addition_data, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_addition)
+    ascii_screen& set_row(std::uint32_t row, char new_character, const addition_type& addition_data, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_addition)
     {
         lo_assert(row >= 0 && row < height);
         lo_assert(start >= 0 && start <= width && start <= end && end <= width);
@@ -255,14 +806,17 @@ public:
         lo_assert(columu >= 0 && columu < width);
         lo_assert(start >= 0 && start <= height && start <= end && end <= height);
         auto* columu_ptr = container().at(start).data() + columu;
-        for (std::uint32_t index = 0; index < end; ++index) {
+        for (std::uint32_t index = start; index < end; ++index) {
             *columu_ptr = new_character;
             columu_ptr += width;
         }
+        if constexpr (is_track_dirty)
+            for (std::uint32_t pos_y = start; pos_y < end; pos_y++)
+                this->mark_dirty(columu, pos_y);
         return *this;
     }
 
-    ascii_screen& set_addition_data_columu(std::uint32_t columu, const std::any& addition_data, std::uint32_t start = 0, std::uint32_t end = height) requires(is_add_addition)
+    ascii_screen& set_addition_data_columu(std::uint32_t columu, const addition_type& addition_data, std::uint32_t start = 0, std::uint32_t end = height) requires(is_add_addition)
     {
         lo_assert(columu >= 0 && columu < width);
         lo_assert(start >= 0 && start <= height && start <= end && end <= height);
@@ -271,7 +825,7 @@ public:
         return *this;
     }
 
-    ascii_screen& set_columu(std::uint32_t columu, char new_character, const std::any& addition_data, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_addition)
+    ascii_screen& set_columu(std::uint32_t columu, char new_character, const addition_type& addition_data, std::uint32_t start = 0, std::uint32_t end = height) requires(is_add_addition)
     {
         lo_assert(columu >= 0 && columu < width);
         lo_assert(start >= 0 && start <= height && start <= end && end <= height);
@@ -280,6 +834,153 @@ public:
         return *this;
     }
 
+    ascii_screen& fill_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, char new_character)
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        detail::fill_rect(data(), width, pos_x, pos_y, rect_width, rect_height, new_character);
+        if constexpr (is_track_dirty)
+            this->mark_dirty_rect(pos_x, pos_y, rect_width, rect_height);
+        return *this;
+    }
+
+    ascii_screen& fill_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, char new_character, const addition_type& addition_data) requires(is_add_addition)
+    {
+        fill_rect(pos_x, pos_y, rect_width, rect_height, new_character);
+        this->fill_addition_data_rect(pos_x, pos_y, rect_width, rect_height, addition_data);
+        return *this;
+    }
+
+    ascii_screen& clear_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height)
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        if constexpr (is_add_addition)
+            this->erase_addition_data_rect(pos_x, pos_y, rect_width, rect_height);
+        if constexpr (is_add_attribute)
+            set_attribute_rect(pos_x, pos_y, rect_width, rect_height, text_attribute {});
+
+        return fill_rect(pos_x, pos_y, rect_width, rect_height, empty_char);
+    }
+
+    /**
+     * @brief Copy characters from a row-major span into the screen, addition data is not touched
+     *
+     * @param src_stride Number of characters between the starts of two rows of the source
+     */
+    ascii_screen& blit(std::uint32_t pos_x, std::uint32_t pos_y, const char* src, std::uint32_t src_width, std::uint32_t src_height, std::size_t src_stride)
+    {
+        lo_assert(pos_x + src_width <= width && pos_y + src_height <= height && src_width <= src_stride);
+        detail::copy_rect(data() + std::size_t(pos_y) * width + pos_x, width, src, src_stride, src_width, src_height);
+        if constexpr (is_track_dirty)
+            this->mark_dirty_rect(pos_x, pos_y, src_width, src_height);
+        return *this;
+    }
+
+    /**
+     * @brief Copy a rectangle of another screen into this screen, addition data is copied along when both screens
+     * use the same addition storage, and so are attributes. `src` must not be this screen, use `scroll_rect` instead
+     */
+    template <std::uint32_t src_width, std::uint32_t src_height, bool src_add_addition, bool src_track_dirty, bool src_add_attribute>
+    ascii_screen& blit(std::uint32_t pos_x, std::uint32_t pos_y, const ascii_screen<src_width, src_height, src_add_addition, src_track_dirty, AdditionStorage, src_add_attribute>& src,
+        std::uint32_t src_x = 0, std::uint32_t src_y = 0, std::uint32_t rect_width = src_width, std::uint32_t rect_height = src_height)
+    {
+        lo_assert(src_x + rect_width <= src_width && src_y + rect_height <= src_height);
+        blit(pos_x, pos_y, src.data() + std::size_t(src_y) * src_width + src_x, rect_width, rect_height, src_width);
+        if constexpr (is_add_addition && src_add_addition)
+            this->copy_addition_data_rect(src, src_x, src_y, rect_width, rect_height, pos_x, pos_y);
+        if constexpr (is_add_attribute && src_add_attribute)
+            detail::copy_rect(this->get_attribute_plane() + std::size_t(pos_y) * width + pos_x, width, src.get_attribute_plane() + std::size_t(src_y) * src_width + src_x, src_width, rect_width, rect_height);
+        return *this;
+    }
+
+    /**
+     * @brief Move the content of a rectangle by (offset_x, offset_y) in place, content moved outside of the
+     * rectangle is dropped and vacated cells are cleared, e.g. `scroll_rect(x, y, w, h, 0, -1)` scrolls a log pane up one line
+     */
+    ascii_screen& scroll_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, std::int64_t offset_x, std::int64_t offset_y)
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        detail::scroll_rect(data(), width, pos_x, pos_y, rect_width, rect_height, offset_x, offset_y, empty_char);
+        if constexpr (is_add_addition)
+            this->scroll_addition_data_rect(pos_x, pos_y, rect_width, rect_height, offset_x, offset_y);
+        if constexpr (is_add_attribute)
+            detail::scroll_rect(this->get_attribute_plane(), width, pos_x, pos_y, rect_width, rect_height, offset_x, offset_y, text_attribute {});
+        if constexpr (is_track_dirty)
+            this->mark_dirty_rect(pos_x, pos_y, rect_width, rect_height);
+        return *this;
+    }
+
+    ascii_screen& scroll(std::int64_t offset_x, std::int64_t offset_y)
+    {
+        return scroll_rect(0, 0, width, height, offset_x, offset_y);
+    }
+
+    // Set `columu_count` adjacent columus at once, one memset per row
+    ascii_screen& set_columus(std::uint32_t columu, std::uint32_t columu_count, char new_character, std::uint32_t start = 0, std::uint32_t end = height)
+    {
+        lo_assert(start <= end && end <= height);
+        return fill_rect(columu, start, columu_count, end - start, new_character);
+    }
+
+    ascii_screen& set_attribute(std::uint32_t pos_x, std::uint32_t pos_y, text_attribute attribute) requires(is_add_attribute)
+    {
+        lo_assert(pos_x < width && pos_y < height);
+        this->get_attribute_plane()[std::size_t(pos_y) * width + pos_x] = attribute;
+        if constexpr (is_track_dirty)
+            this->mark_dirty(pos_x, pos_y);
+        return *this;
+    }
+
+    ascii_screen& set_attribute(text_attribute attribute) requires(is_add_attribute)
+    {
+        return set_attribute_rect(0, 0, width, height, attribute);
+    }
+
+    ascii_screen& set_attribute_row(std::uint32_t row, text_attribute attribute, std::uint32_t start = 0, std::uint32_t end = width) requires(is_add_attribute)
+    {
+        lo_assert(start <= end && end <= width);
+        return set_attribute_rect(start, row, end - start, 1, attribute);
+    }
+
+    ascii_screen& set_attribute_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, text_attribute attribute) requires(is_add_attribute)
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        detail::fill_rect(this->get_attribute_plane(), width, pos_x, pos_y, rect_width, rect_height, attribute);
+        if constexpr (is_track_dirty)
+            this->mark_dirty_rect(pos_x, pos_y, rect_width, rect_height);
+        return *this;
+    }
+
+    // Count the cells equal to `target`, SIMD accelerated when available (see screen_kernels.h)
+    [[nodiscard]] std::size_t count(char target) const noexcept
+    {
+        return detail::count_char(data(), size(), target);
+    }
+
+    [[nodiscard]] std::size_t count(char target, std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height) const noexcept
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        return detail::count_char_rect(data(), width, pos_x, pos_y, rect_width, rect_height, target);
+    }
+
+    // Find the first cell (in row-major order) of a rectangle that is equal to `target`, return its columu and row
+    [[nodiscard]] std::optional<std::pair<std::uint32_t, std::uint32_t>> find(char target, std::uint32_t pos_x = 0, std::uint32_t pos_y = 0, std::uint32_t rect_width = width, std::uint32_t rect_height = height) const noexcept
+    {
+        lo_assert(pos_x + rect_width <= width && pos_y + rect_height <= height);
+        std::uint32_t found_x = 0;
+        std::uint32_t found_y = 0;
+        if (detail::find_char_rect(data(), width, pos_x, pos_y, rect_width, rect_height, target, found_x, found_y))
+            return std::pair { found_x, found_y };
+        return std::nullopt;
+    }
+
+    // Number of occurrences of every character, indexed by `static_cast<unsigned char>(character)`
+    [[nodiscard]] std::array<std::size_t, 256> histogram() const noexcept
+    {
+        std::array<std::size_t, 256> result {};
+        detail::add_histogram(data(), size(), result);
+        return result;
+    }
+
     char get(std::uint32_t pos_x, std::uint32_t pos_y)
     {
         lo_assert(pos_x >= 0 && pos_x < width && pos_y >= 0 && pos_y < height);
@@ -288,6 +989,14 @@ public:
 
     ascii_screen& show(std::ostream& out)
     {
+        if constexpr (is_add_attribute)
+        {
+            thread_local std::string frame_buffer;
+            show(frame_buffer);
+            out.write(frame_buffer.data(), static_cast<std::streamsize>(frame_buffer.size()));
+            return *this;
+        }
+
         auto&& screen = container();
         for (auto&& row : screen) {
             out.write(row.data(), row.size());
@@ -296,8 +1005,232 @@ public:
         return *this;
     }
 
+    // Write the frame to a file descriptor, usually in one `writev` syscall without going through std::ostream
+    ascii_screen& show(int file_descriptor)
+    {
+        if constexpr (is_add_attribute)
+        {
+            thread_local std::string frame_buffer;
+            show(frame_buffer);
+            detail::write_all(file_descriptor, frame_buffer.data(), frame_buffer.size());
+        } else {
+            detail::write_frame(file_descriptor, data(), width, width, height);
+        }
+        return *this;
+    }
+
+    // Build the whole frame (rows separated by '\n') into a reusable buffer
+    ascii_screen& show(std::string& frame_buffer)
+    {
+        if constexpr (is_add_attribute)
+            detail::append_attribute_frame(frame_buffer, data(), this->get_attribute_plane(), width, height);
+        else
+            detail::append_frame(frame_buffer, data(), width, width, height);
+        return *this;
+    }
+
 private:
     std::unique_ptr<std::array<std::array<char, width>, height>> screen_char_ptr_;
 };
 
+// The disabled policies are empty bases, a plain screen is just the pointer to its cells
+static_assert(sizeof(ascii_screen<80, 24>) == sizeof(std::unique_ptr<std::array<std::array<char, 80>, 24>>));
+
+/**
+ * @brief Render mode of ascii_screen that keeps the last presented frame and only emits cursor-move
+ * and replace sequences for the spans that changed, falls back to a full repaint when the dirty part
+ * of the frame is larger than `full_repaint_ratio`.
+ * A non-const screen that tracks dirty regions is rendered by comparing only its dirty region, then the renderer clears
+ * it. If anything else cleared the dirty region since the last render the renderer sees it by the dirty epoch and
+ * compares the whole frame, so changes are never missed, only the saving is lost
+ *
+ * @tparam width Width of the screen
+ * @tparam height Height of the screen
+ */
+template <std::uint32_t width, std::uint32_t height>
+class incremental_renderer
+{
+public:
+    // A cursor move costs about 8 bytes, so rewriting a few equal characters is cheaper than jumping over them
+    static constexpr std::uint32_t merge_gap = 8;
+
+    explicit incremental_renderer(float full_repaint_ratio = 0.5F)
+        : last_frame_ptr_(std::make_unique<std::array<std::array<char, width>, height>>()), full_repaint_ratio_(full_repaint_ratio)
+    {
+        lo_assert(full_repaint_ratio >= 0.0F && full_repaint_ratio <= 1.0F);
+    }
+
+    [[nodiscard]] float get_full_repaint_ratio() const noexcept
+    {
+        return full_repaint_ratio_;
+    }
+
+    incremental_renderer& set_full_repaint_ratio(float full_repaint_ratio) noexcept
+    {
+        lo_assert(full_repaint_ratio >= 0.0F && full_repaint_ratio <= 1.0F);
+        full_repaint_ratio_ = full_repaint_ratio;
+        return *this;
+    }
+
+    // The next render will repaint the whole frame, e.g. after the terminal was cleared by someone else
+    incremental_renderer& invalidate() noexcept
+    {
+        is_vaild_ = false;
+        return *this;
+    }
+
+    // Compare the whole frame, the dirty region of the screen is neither used nor cleared
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    incremental_renderer& render(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::ostream& out)
+    {
+        return render_frame(screen, out, false);
+    }
+
+    // Compare only the dirty region of the screen and clear it after the render, see the class comment
+    template <bool is_add_addition, typename AdditionStorage, bool is_add_attribute>
+    incremental_renderer& render(ascii_screen<width, height, is_add_addition, true, AdditionStorage, is_add_attribute>& screen, std::ostream& out)
+    {
+        render_frame(screen, out, screen.get_dirty_epoch() == dirty_epoch_);
+        screen.clear_dirty();
+        dirty_epoch_ = screen.get_dirty_epoch();
+        return *this;
+    }
+
+private:
+    static constexpr std::size_t cell_count = std::size_t(width) * height;
+
+    struct changed_span
+    {
+        std::uint32_t row;
+        std::uint32_t start;
+        std::uint32_t end;
+    };
+
+    // `is_use_dirty` compares only the dirty region, the caller checked that it covers every change since the last frame
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    incremental_renderer& render_frame(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::ostream& out, bool is_use_dirty)
+    {
+        const char* current = screen.data();
+        char* last = last_frame();
+        const text_attribute* current_attribute = nullptr;
+        text_attribute* last_attribute = nullptr;
+
+        if constexpr (is_add_attribute)
+        {
+            if (!last_attribute_ptr_)
+            {
+                last_attribute_ptr_ = std::make_unique<std::array<text_attribute, cell_count>>();
+                is_vaild_ = false;
+            }
+            current_attribute = screen.get_attribute_plane();
+            last_attribute = last_attribute_ptr_->data();
+        }
+
+        output_buffer_.clear();
+        if (!is_vaild_)
+            return full_repaint(current, current_attribute, out);
+
+        std::size_t dirty_size = 0;
+        span_list_.clear();
+        auto compare_row = [&](std::uint32_t row, std::uint32_t first, std::uint32_t last_columu) {
+            const std::size_t offset = std::size_t(row) * width + first;
+            auto add_span = [&](std::uint32_t start, std::uint32_t end) {
+                span_list_.push_back({ row, first + start, first + end });
+                dirty_size += end - start;
+            };
+
+            if constexpr (is_add_attribute)
+            {
+                detail::for_each_changed_span(
+                    last_columu - first, merge_gap, [&](std::uint32_t pos_x) {
+                        return last[offset + pos_x] != current[offset + pos_x] || last_attribute[offset + pos_x] != current_attribute[offset + pos_x];
+                    },
+                    add_span);
+            } else {
+                detail::for_each_changed_span(last + offset, current + offset, last_columu - first, merge_gap, add_span);
+            }
+        };
+
+        bool is_compared = false;
+        if constexpr (is_track_dirty)
+        {
+            if (is_use_dirty)
+            {
+                screen.for_each_dirty_row(compare_row);
+                is_compared = true;
+            }
+        }
+        if (!is_compared)
+        {
+            for (std::uint32_t row = 0; row < height; ++row)
+                compare_row(row, 0, width);
+        }
+
+        if (static_cast<float>(dirty_size) > full_repaint_ratio_ * static_cast<float>(cell_count))
+            return full_repaint(current, current_attribute, out);
+
+        text_attribute terminal_attribute {};
+        for (auto&& [row, start, end] : span_list_)
+        {
+            const std::size_t offset = std::size_t(row) * width + start;
+            detail::append_cursor_move(output_buffer_, row, start);
+            if constexpr (is_add_attribute)
+            {
+                detail::append_attribute_span(output_buffer_, current + offset, current_attribute + offset, end - start, terminal_attribute);
+                std::copy_n(current_attribute + offset, end - start, last_attribute + offset);
+            } else {
+                output_buffer_.append(current + offset, end - start);
+            }
+            std::memcpy(last + offset, current + offset, end - start);
+        }
+
+        if (!terminal_attribute.is_default())
+            text_attribute {}.append_sgr(output_buffer_);
+        out.write(output_buffer_.data(), static_cast<std::streamsize>(output_buffer_.size()));
+        return *this;
+    }
+
+    char* last_frame() noexcept
+    {
+        return reinterpret_cast<char*>(last_frame_ptr_->data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+
+    // `current_attribute` is nullptr when the screen has no attributes
+    incremental_renderer& full_repaint(const char* current, const text_attribute* current_attribute, std::ostream& out)
+    {
+        output_buffer_ += "\033[H";
+        for (std::uint32_t row = 0; row < height; ++row)
+        {
+            if (row != 0)
+                output_buffer_ += "\r\n";
+
+            const std::size_t offset = std::size_t(row) * width;
+            if (current_attribute != nullptr)
+            {
+                text_attribute terminal_attribute {};
+                detail::append_attribute_span(output_buffer_, current + offset, current_attribute + offset, width, terminal_attribute);
+                if (!terminal_attribute.is_default())
+                    text_attribute {}.append_sgr(output_buffer_);
+            } else {
+                output_buffer_.append(current + offset, width);
+            }
+        }
+        out.write(output_buffer_.data(), static_cast<std::streamsize>(output_buffer_.size()));
+
+        std::memcpy(last_frame(), current, cell_count);
+        if (current_attribute != nullptr)
+            std::copy_n(current_attribute, cell_count, last_attribute_ptr_->data());
+        is_vaild_ = true;
+        return *this;
+    }
+
+    std::unique_ptr<std::array<std::array<char, width>, height>> last_frame_ptr_;
+    std::unique_ptr<std::array<text_attribute, cell_count>> last_attribute_ptr_;
+    std::vector<changed_span> span_list_;
+    std::string output_buffer_;
+    float full_repaint_ratio_;
+    std::uint64_t dirty_epoch_ = 0; // Dirty epoch of the screen after the last render cleared it
+    bool is_vaild_ = false;
+};
+
 } // namespace lot
\ No newline at end of file
@@ -9,4 +9,11 @@ namespace lot {
 #    define lo_assert(expression) assert(expression) // NOLINT(cppcoreguidelines-macro-usage)
 #endif
 
+// MSVC only applies the empty base optimization to the first empty base unless the class asks for it
+#if defined(_MSC_VER)
+#    define LOT_EMPTY_BASES __declspec(empty_bases) // NOLINT(cppcoreguidelines-macro-usage)
+#else
+#    define LOT_EMPTY_BASES // NOLINT(cppcoreguidelines-macro-usage)
+#endif
+
 } // namespace lot
\ No newline at end of file
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "ascii_screen.h"
+#include "base.h"
+#include "screen_kernels.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace lot {
+
+/**
+ * @brief A large virtual character map made of fixed size ascii_screen tiles. A tile is allocated on the first
+ * write of a non-empty character and released as soon as it only holds empty_char again, so the memory scales
+ * with the touched area rather than the nominal size. Use `view` to blit a window of the map to a terminal sized screen
+ *
+ * @tparam tile_width Width of a tile
+ * @tparam tile_height Height of a tile
+ */
+template <std::uint32_t tile_width = 64, std::uint32_t tile_height = 64>
+class chunked_ascii_screen
+{
+public:
+    using tile_type = ascii_screen<tile_width, tile_height>;
+    static constexpr char empty_char = tile_type::empty_char;
+
+    chunked_ascii_screen(std::uint32_t width, std::uint32_t height)
+        : width_(width), height_(height), tile_columu_count_((width + tile_width - 1) / tile_width), tile_row_count_((height + tile_height - 1) / tile_height)
+    {
+        tile_list_.resize(std::size_t(tile_columu_count_) * tile_row_count_);
+    }
+
+    [[nodiscard]] std::uint32_t width() const noexcept
+    {
+        return width_;
+    }
+
+    [[nodiscard]] std::uint32_t height() const noexcept
+    {
+        return height_;
+    }
+
+    // Number of tiles that are currently allocated
+    [[nodiscard]] std::size_t tile_count() const noexcept
+    {
+        return allocated_tile_count_;
+    }
+
+    // Approximate number of bytes used by the map
+    [[nodiscard]] std::size_t memory_usage() const noexcept
+    {
+        return tile_list_.capacity() * sizeof(tile_entry) + allocated_tile_count_ * std::size_t(tile_width) * tile_height;
+    }
+
+    // The tile at (tile_x, tile_y) in tile units, nullptr when it is not allocated
+    [[nodiscard]] const tile_type* get_tile(std::uint32_t tile_x, std::uint32_t tile_y) const noexcept
+    {
+        lo_assert(tile_x < tile_columu_count_ && tile_y < tile_row_count_);
+        const auto& entry = tile_list_[std::size_t(tile_y) * tile_columu_count_ + tile_x];
+        return entry.screen ? &*entry.screen : nullptr;
+    }
+
+    // Call `func(tile_x, tile_y, const tile_type&)` for every allocated tile
+    template <typename Func>
+    void for_each_tile(Func&& func) const
+    {
+        for (std::size_t index = 0; index < tile_list_.size(); ++index)
+            if (tile_list_[index].screen)
+                func(static_cast<std::uint32_t>(index % tile_columu_count_), static_cast<std::uint32_t>(index / tile_columu_count_), *tile_list_[index].screen);
+    }
+
+    [[nodiscard]] char get(std::uint32_t pos_x, std::uint32_t pos_y) const
+    {
+        lo_assert(pos_x < width_ && pos_y < height_);
+        const auto& entry = tile_list_[get_tile_index(pos_x, pos_y)];
+        if (!entry.screen)
+            return empty_char;
+        return entry.screen->data()[std::size_t(pos_y % tile_height) * tile_width + pos_x % tile_width];
+    }
+
+    chunked_ascii_screen& set(std::uint32_t pos_x, std::uint32_t pos_y, char new_character)
+    {
+        lo_assert(pos_x < width_ && pos_y < height_);
+        const std::size_t tile_index = get_tile_index(pos_x, pos_y);
+        auto& entry = tile_list_[tile_index];
+        if (!entry.screen && new_character == empty_char)
+            return *this;
+
+        auto& tile = get_or_create_tile(tile_index);
+        const std::uint32_t local_x = pos_x % tile_width;
+        const std::uint32_t local_y = pos_y % tile_height;
+        entry.used_count -= static_cast<std::uint32_t>(tile.get(local_x, local_y) != empty_char);
+        entry.used_count += static_cast<std::uint32_t>(new_character != empty_char);
+        tile.set(local_x, local_y, new_character);
+        release_if_empty(tile_index);
+        return *this;
+    }
+
+    chunked_ascii_screen& clear()
+    {
+        for (auto& entry : tile_list_)
+            entry = tile_entry {};
+        allocated_tile_count_ = 0;
+        return *this;
+    }
+
+    chunked_ascii_screen& clear(std::uint32_t pos_x, std::uint32_t pos_y)
+    {
+        return set(pos_x, pos_y, empty_char);
+    }
+
+    chunked_ascii_screen& fill_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, char new_character)
+    {
+        lo_assert(std::uint64_t(pos_x) + rect_width <= width_ && std::uint64_t(pos_y) + rect_height <= height_);
+        for_each_tile_rect(pos_x, pos_y, rect_width, rect_height, [&](std::size_t tile_index, std::uint32_t local_x, std::uint32_t local_y, std::uint32_t part_width, std::uint32_t part_height, std::uint32_t, std::uint32_t) {
+            auto& entry = tile_list_[tile_index];
+            if (new_character == empty_char)
+            {
+                if (!entry.screen)
+                    return;
+                if (part_width == tile_width && part_height == tile_height)
+                {
+                    release_tile(tile_index);
+                    return;
+                }
+            }
+
+            auto& tile = get_or_create_tile(tile_index);
+            entry.used_count -= count_used(tile, local_x, local_y, part_width, part_height);
+            tile.fill_rect(local_x, local_y, part_width, part_height, new_character);
+            if (new_character != empty_char)
+                entry.used_count += part_width * part_height;
+            release_if_empty(tile_index);
+        });
+        return *this;
+    }
+
+    chunked_ascii_screen& clear_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height)
+    {
+        return fill_rect(pos_x, pos_y, rect_width, rect_height, empty_char);
+    }
+
+    chunked_ascii_screen& set_row(std::uint32_t row, char new_character, std::uint32_t start, std::uint32_t end)
+    {
+        lo_assert(start <= end);
+        return fill_rect(start, row, end - start, 1, new_character);
+    }
+
+    chunked_ascii_screen& set_columu(std::uint32_t columu, char new_character, std::uint32_t start, std::uint32_t end)
+    {
+        lo_assert(start <= end);
+        return fill_rect(columu, start, 1, end - start, new_character);
+    }
+
+    /**
+     * @brief Copy characters from a row-major span into the map, tiles are only allocated where the source is not empty
+     *
+     * @param src_stride Number of characters between the starts of two rows of the source
+     */
+    chunked_ascii_screen& blit(std::uint32_t pos_x, std::uint32_t pos_y, const char* src, std::uint32_t src_width, std::uint32_t src_height, std::size_t src_stride)
+    {
+        lo_assert(std::uint64_t(pos_x) + src_width <= width_ && std::uint64_t(pos_y) + src_height <= height_);
+        for_each_tile_rect(pos_x, pos_y, src_width, src_height, [&](std::size_t tile_index, std::uint32_t local_x, std::uint32_t local_y, std::uint32_t part_width, std::uint32_t part_height, std::uint32_t offset_x, std::uint32_t offset_y) {
+            const char* part_src = src + offset_y * src_stride + offset_x;
+            const auto part_used = static_cast<std::uint32_t>(part_width * part_height - detail::count_char_rect(part_src, src_stride, 0, 0, part_width, part_height, empty_char));
+
+            auto& entry = tile_list_[tile_index];
+            if (!entry.screen && part_used == 0)
+                return;
+
+            auto& tile = get_or_create_tile(tile_index);
+            entry.used_count -= count_used(tile, local_x, local_y, part_width, part_height);
+            tile.blit(local_x, local_y, part_src, part_width, part_height, src_stride);
+            entry.used_count += part_used;
+            release_if_empty(tile_index);
+        });
+        return *this;
+    }
+
+    /**
+     * @brief Copy the window of the map starting at (origin_x, origin_y) into a row-major buffer,
+     * cells outside of the map or in unallocated tiles become empty_char
+     */
+    void view(std::int64_t origin_x, std::int64_t origin_y, char* dst, std::uint32_t view_width, std::uint32_t view_height, std::size_t dst_stride) const
+    {
+        detail::fill_rect(dst, dst_stride, 0, 0, view_width, view_height, empty_char);
+
+        // Clip the window to the map
+        const std::int64_t begin_x = std::max<std::int64_t>(origin_x, 0);
+        const std::int64_t begin_y = std::max<std::int64_t>(origin_y, 0);
+        const std::int64_t end_x = std::min<std::int64_t>(origin_x + view_width, width_);
+        const std::int64_t end_y = std::min<std::int64_t>(origin_y + view_height, height_);
+        if (begin_x >= end_x || begin_y >= end_y)
+            return;
+
+        for_each_tile_rect(static_cast<std::uint32_t>(begin_x), static_cast<std::uint32_t>(begin_y), static_cast<std::uint32_t>(end_x - begin_x), static_cast<std::uint32_t>(end_y - begin_y),
+            [&](std::size_t tile_index, std::uint32_t local_x, std::uint32_t local_y, std::uint32_t part_width, std::uint32_t part_height, std::uint32_t offset_x, std::uint32_t offset_y) {
+                const auto& entry = tile_list_[tile_index];
+                if (!entry.screen)
+                    return;
+
+                char* part_dst = dst + (begin_y - origin_y + offset_y) * dst_stride + (begin_x - origin_x + offset_x);
+                detail::copy_rect(part_dst, dst_stride, entry.screen->data() + std::size_t(local_y) * tile_width + local_x, tile_width, part_width, part_height);
+            });
+    }
+
+    // Copy the window starting at (origin_x, origin_y) into a screen of the same API, e.g. ascii_screen or dynamic_ascii_screen
+    template <typename Screen>
+    void view(std::int64_t origin_x, std::int64_t origin_y, Screen& screen) const
+    {
+        const auto screen_width = static_cast<std::uint32_t>(screen.size() / (screen.size() == 0 ? 1 : screen_height_of(screen)));
+        view(origin_x, origin_y, screen.data(), screen_width, screen_height_of(screen), screen_width);
+        if constexpr (requires { screen.mark_dirty(); })
+            screen.mark_dirty();
+    }
+
+private:
+    struct tile_entry
+    {
+        std::optional<tile_type> screen;
+        std::uint32_t used_count = 0; // Number of cells that are not empty_char
+    };
+
+    template <typename Screen>
+    static std::uint32_t screen_height_of(const Screen& screen)
+    {
+        if constexpr (requires { screen.height(); })
+            return screen.height();
+        else
+            return static_cast<std::uint32_t>(screen.container().size());
+    }
+
+    [[nodiscard]] std::size_t get_tile_index(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+    {
+        return std::size_t(pos_y / tile_height) * tile_columu_count_ + pos_x / tile_width;
+    }
+
+    tile_type& get_or_create_tile(std::size_t tile_index)
+    {
+        auto& entry = tile_list_[tile_index];
+        if (!entry.screen)
+        {
+            entry.screen.emplace();
+            entry.used_count = 0;
+            ++allocated_tile_count_;
+        }
+        return *entry.screen;
+    }
+
+    void release_tile(std::size_t tile_index)
+    {
+        tile_list_[tile_index] = tile_entry {};
+        --allocated_tile_count_;
+    }
+
+    void release_if_empty(std::size_t tile_index)
+    {
+        if (tile_list_[tile_index].used_count == 0)
+            release_tile(tile_index);
+    }
+
+    static std::uint32_t count_used(const tile_type& tile, std::uint32_t local_x, std::uint32_t local_y, std::uint32_t part_width, std::uint32_t part_height)
+    {
+        return part_width * part_height - static_cast<std::uint32_t>(tile.count(empty_char, local_x, local_y, part_width, part_height));
+    }
+
+    /**
+     * @brief Split a rectangle of the map by tiles, call `func(tile_index, local_x, local_y, part_width, part_height, offset_x, offset_y)`
+     * where (local_x, local_y) is the part inside the tile and (offset_x, offset_y) is the part inside the rectangle
+     */
+    template <typename Func>
+    void for_each_tile_rect(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, Func&& func) const
+    {
+        for (std::uint32_t row = pos_y; row < pos_y + rect_height;)
+        {
+            const std::uint32_t local_y = row % tile_height;
+            const std::uint32_t part_height = (std::min)(tile_height - local_y, pos_y + rect_height - row);
+            for (std::uint32_t columu = pos_x; columu < pos_x + rect_width;)
+            {
+                const std::uint32_t local_x = columu % tile_width;
+                const std::uint32_t part_width = (std::min)(tile_width - local_x, pos_x + rect_width - columu);
+                func(get_tile_index(columu, row), local_x, local_y, part_width, part_height, columu - pos_x, row - pos_y);
+                columu += part_width;
+            }
+            row += part_height;
+        }
+    }
+
+    std::uint32_t width_;
+    std::uint32_t height_;
+    std::uint32_t tile_columu_count_;
+    std::uint32_t tile_row_count_;
+    std::size_t allocated_tile_count_ = 0;
+    std::vector<tile_entry> tile_list_;
+};
+
+} // namespace lot
\ No newline at end of file
@@ -0,0 +1,380 @@
+#pragma once
+
+#include "base.h"
+#include "cmdparser.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#    include <cerrno>
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <system_error>
+#    include <unistd.h>
+#endif
+
+namespace lot {
+
+/**
+ * @brief Split a command line into arguments with shell-like quoting: whitespace separates arguments, 'single quotes'
+ * are literal, "double quotes" allow \" \\ \$ \` escapes, a backslash outside quotes escapes the next character and
+ * an unquoted '#' at the start of an argument begins a comment. Throw args_parse_error on an unterminated quote
+ *
+ * @param storage Receives the unescaped text, the returned views point into it, so it must outlive them
+ * @param token_list Cleared, then receives the arguments
+ */
+inline void tokenize_command_line(std::string_view line, std::string& storage, std::vector<std::string_view>& token_list)
+{
+    storage.clear();
+    storage.reserve(line.size()); // The unescaped text is never longer, so the views are not invalidated by reallocation
+    token_list.clear();
+
+    std::size_t pos = 0;
+    while (true)
+    {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r' || line[pos] == '\n'))
+            ++pos;
+        if (pos == line.size() || line[pos] == '#')
+            return;
+
+        const std::size_t token_begin = storage.size();
+        while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t' && line[pos] != '\r' && line[pos] != '\n')
+        {
+            const char character = line[pos++];
+            if (character == '\'')
+            {
+                const auto quote_end = line.find('\'', pos);
+                if (quote_end == std::string_view::npos)
+                    throw args_parse_error("Parameter parsing error: Unterminated ' in \"" + std::string(line) + "\"");
+                storage.append(line.substr(pos, quote_end - pos));
+                pos = quote_end + 1;
+            } else if (character == '"') {
+                while (true)
+                {
+                    if (pos == line.size())
+                        throw args_parse_error("Parameter parsing error: Unterminated \" in \"" + std::string(line) + "\"");
+                    const char quoted = line[pos++];
+                    if (quoted == '"')
+                        break;
+                    if (quoted == '\\' && pos < line.size() && (line[pos] == '"' || line[pos] == '\\' || line[pos] == '$' || line[pos] == '`'))
+                        storage.push_back(line[pos++]);
+                    else
+                        storage.push_back(quoted);
+                }
+            } else if (character == '\\' && pos < line.size()) {
+                storage.push_back(line[pos++]);
+            } else {
+                storage.push_back(character);
+            }
+        }
+        token_list.emplace_back(storage.data() + token_begin, storage.size() - token_begin);
+    }
+}
+
+struct batch_stats
+{
+    std::size_t command_count = 0; // Lines that contained a command
+    std::size_t error_count = 0;   // Commands that threw
+};
+
+/**
+ * @brief Run many command lines in one process through the commands registered on a cmdparser, so a script pays
+ * process startup and command registration once. Lines come from a stream, a file or (not on Windows) a Unix socket,
+ * they are tokenized by `tokenize_command_line` and every line gets a fresh parse state. Empty and comment lines are skipped
+ */
+class batch_runner
+{
+public:
+    // Called with the line number (from 1), the line and the exception when a command throws, writes to stderr by default
+    using error_handler = std::function<void(std::size_t, std::string_view, const std::exception&)>;
+
+    // `registry` holds the registered commands and is not parsed itself, the runner keeps a shared_registry of it
+    explicit batch_runner(const cmdparser& registry)
+        : registry_(registry.shared_registry()), error_handler_([](std::size_t line_number, std::string_view /*line*/, const std::exception& error) {
+              std::fprintf(stderr, "line %zu: %s\n", line_number, error.what());
+          })
+    {
+    }
+
+    batch_runner& set_error_handler(error_handler handler)
+    {
+        error_handler_ = std::move(handler);
+        return *this;
+    }
+
+    // Run the lines one after another, one parser is reused for every line
+    batch_stats run(std::istream& in)
+    {
+        batch_stats stats;
+        cmdparser parser(registry_);
+        std::string line;
+        std::string storage;
+        std::vector<std::string_view> token_list;
+        for (std::size_t line_number = 1; std::getline(in, line); ++line_number)
+            run_line(parser, line_number, line, storage, token_list, stats);
+        return stats;
+    }
+
+    batch_stats run(const std::filesystem::path& path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("batch_runner open fails : " + path.string());
+        return run(in);
+    }
+
+    /**
+     * @brief Run independent lines on `worker_count` threads, the order in which the commands run is not specified.
+     * The commands must be safe to call concurrently, the error handler is called under its own lock so a slow handler
+     * doesn't hold up the queue
+     */
+    batch_stats run_parallel(std::istream& in, std::size_t worker_count = std::thread::hardware_concurrency())
+    {
+        if (worker_count <= 1)
+            return run(in);
+
+        struct pending_line
+        {
+            std::size_t line_number;
+            std::string text;
+        };
+
+        std::mutex mutex;
+        std::mutex error_mutex;
+        std::condition_variable_any condition;
+        std::condition_variable_any space_condition;
+        std::deque<pending_line> pending_list;
+        bool is_end = false;
+        constexpr std::size_t max_pending_count = 1024; // Don't read a huge input faster than it runs
+
+        std::atomic<std::size_t> command_count = 0;
+        std::atomic<std::size_t> error_count = 0;
+
+        auto worker = [&] {
+            batch_stats stats;
+            cmdparser parser(registry_);
+            std::string storage;
+            std::vector<std::string_view> token_list;
+            while (true)
+            {
+                pending_line line;
+                {
+                    std::unique_lock lock(mutex);
+                    condition.wait(lock, [&] { return !pending_list.empty() || is_end; });
+                    if (pending_list.empty())
+                        break;
+                    line = std::move(pending_list.front());
+                    pending_list.pop_front();
+                }
+                space_condition.notify_one();
+                run_line(parser, line.line_number, line.text, storage, token_list, stats, &error_mutex);
+            }
+            command_count += stats.command_count;
+            error_count += stats.error_count;
+        };
+
+        {
+            std::vector<std::jthread> worker_list;
+            worker_list.reserve(worker_count);
+            for (std::size_t index = 0; index < worker_count; ++index)
+                worker_list.emplace_back(worker);
+
+            std::string text;
+            for (std::size_t line_number = 1; std::getline(in, text); ++line_number)
+            {
+                {
+                    std::unique_lock lock(mutex);
+                    space_condition.wait(lock, [&] { return pending_list.size() < max_pending_count; });
+                    pending_list.push_back({ line_number, std::move(text) });
+                }
+                condition.notify_one();
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                is_end = true;
+            }
+            condition.notify_all();
+        }
+
+        return { command_count.load(), error_count.load() };
+    }
+
+#ifndef _WIN32
+    /**
+     * @brief Listen on a Unix socket and run the lines sent by clients until `stop_token` is requested, the socket file
+     * is replaced. Connections are served one at a time, every line is answered with "ok\n" or "error <message>\n"
+     */
+    batch_stats serve(const std::filesystem::path& socket_path, std::stop_token stop_token = {})
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        const auto& native_path = socket_path.native();
+        if (native_path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("batch_runner socket path is too long : " + socket_path.string());
+        native_path.copy(address.sun_path, native_path.size());
+
+        const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0)
+            throw std::system_error(errno, std::generic_category(), "batch_runner socket fails");
+        socket_guard server_guard { server };
+        set_close_on_exec(server);
+
+        ::unlink(native_path.c_str());
+        if (::bind(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(server, 16) != 0) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            throw std::system_error(errno, std::generic_category(), "batch_runner listen fails : " + socket_path.string());
+
+        batch_stats stats;
+        cmdparser parser(registry_);
+        std::string storage;
+        std::vector<std::string_view> token_list;
+        while (!stop_token.stop_requested())
+        {
+            if (!wait_readable(server, stop_token))
+                break;
+            const int client = ::accept(server, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "batch_runner accept fails");
+            }
+            socket_guard client_guard { client };
+            set_close_on_exec(client);
+#    ifdef SO_NOSIGPIPE
+            const int is_no_sigpipe = 1;
+            ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &is_no_sigpipe, sizeof(is_no_sigpipe));
+#    endif
+
+            std::string buffer;
+            std::size_t line_number = 0;
+            std::array<char, 4096> chunk {};
+            while (wait_readable(client, stop_token))
+            {
+                const auto read_count = ::read(client, chunk.data(), chunk.size());
+                if (read_count < 0 && errno == EINTR)
+                    continue;
+                if (read_count <= 0)
+                    break;
+                buffer.append(chunk.data(), static_cast<std::size_t>(read_count));
+
+                std::size_t line_begin = 0;
+                for (auto line_end = buffer.find('\n'); line_end != std::string::npos; line_end = buffer.find('\n', line_begin))
+                {
+                    std::string reply = "ok\n";
+                    const std::string_view line(buffer.data() + line_begin, line_end - line_begin);
+                    run_line(parser, ++line_number, line, storage, token_list, stats, nullptr, &reply);
+                    send_all(client, reply);
+                    line_begin = line_end + 1;
+                }
+                buffer.erase(0, line_begin);
+            }
+        }
+
+        ::unlink(native_path.c_str());
+        return stats;
+    }
+#endif
+
+private:
+    void run_line(cmdparser& parser, std::size_t line_number, std::string_view line, std::string& storage, std::vector<std::string_view>& token_list,
+        batch_stats& stats, std::mutex* error_mutex = nullptr, std::string* reply = nullptr)
+    {
+        try {
+            tokenize_command_line(line, storage, token_list);
+            if (token_list.empty())
+                return;
+
+            ++stats.command_count;
+            parser.reset(token_list);
+            parser.parse();
+            parser.exec();
+        } catch (const std::exception& error) {
+            ++stats.error_count;
+            if (reply != nullptr)
+                *reply = std::string("error ") + error.what() + "\n";
+
+            if (error_mutex != nullptr)
+            {
+                std::lock_guard lock(*error_mutex);
+                error_handler_(line_number, line, error);
+            } else {
+                error_handler_(line_number, line, error);
+            }
+        }
+    }
+
+#ifndef _WIN32
+    struct socket_guard // NOLINT(cppcoreguidelines-special-member-functions)
+    {
+        int file_descriptor;
+        ~socket_guard() { ::close(file_descriptor); }
+    };
+
+    // accept4 and SOCK_CLOEXEC are not portable, so the flag is set afterwards
+    static void set_close_on_exec(int file_descriptor)
+    {
+        const int flags = ::fcntl(file_descriptor, F_GETFD);
+        if (flags < 0 || ::fcntl(file_descriptor, F_SETFD, flags | FD_CLOEXEC) != 0)
+            throw std::system_error(errno, std::generic_category(), "batch_runner fcntl fails");
+    }
+
+    // Wait until the socket can be read, checking the stop token every 100ms
+    static bool wait_readable(int file_descriptor, const std::stop_token& stop_token)
+    {
+        pollfd poll_item { file_descriptor, POLLIN, 0 };
+        while (!stop_token.stop_requested())
+        {
+            const int result = ::poll(&poll_item, 1, 100);
+            if (result > 0)
+                return true;
+            if (result < 0 && errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "batch_runner poll fails");
+        }
+        return false;
+    }
+
+    // A client that went away must not raise SIGPIPE: MSG_NOSIGNAL where it exists, SO_NOSIGPIPE (set in serve) otherwise
+    static void send_all(int file_descriptor, std::string_view data)
+    {
+#    ifdef MSG_NOSIGNAL
+        constexpr int send_flags = MSG_NOSIGNAL;
+#    else
+        constexpr int send_flags = 0;
+#    endif
+        while (!data.empty())
+        {
+            const auto written = ::send(file_descriptor, data.data(), data.size(), send_flags);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return; // The client went away, its remaining replies are dropped
+            }
+            data.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+#endif
+
+    std::shared_ptr<const cmdparser::command_map> registry_;
+    error_handler error_handler_;
+};
+
+} // namespace lot
\ No newline at end of file
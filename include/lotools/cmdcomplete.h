@@ -0,0 +1,258 @@
+#pragma once
+
+#include "base.h"
+#include "cmdparser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lot {
+
+/**
+ * @brief The completion candidates of the registered commands: command names at every level of the command tree
+ * (see command_group) and the options the commands declare (see basic_command::get_option_names). Every level keeps
+ * its names sorted, so the candidates of a prefix are found by binary search without running any handler.
+ * Commands whose name starts with "__" are hidden
+ */
+class completion_index
+{
+public:
+    static constexpr std::uint32_t no_child = UINT32_MAX;
+
+    // One level of the command tree, node 0 is the root
+    struct node
+    {
+        std::string path;                     // The command names leading to the level joined by spaces, empty for the root
+        std::vector<std::string> name_list;   // Sorted subcommand and option names
+        std::vector<std::uint32_t> child_list; // Node of each name, no_child for options
+    };
+
+    explicit completion_index(const cmdparser::command_map& command_map)
+    {
+        node_list_.emplace_back();
+        build_node(0, command_map, {});
+    }
+
+    /**
+     * @brief Find the candidates that complete `partial` after `words`. Words naming a subcommand of the current
+     * level descend into it, as cmdparser::parse does, other words are skipped
+     *
+     * @param candidate_list Cleared, then receives views into the index
+     */
+    void complete(std::span<const std::string_view> words, std::string_view partial, std::vector<std::string_view>& candidate_list) const
+    {
+        candidate_list.clear();
+
+        std::uint32_t node_index = 0;
+        for (auto word : words)
+        {
+            if (word.starts_with("--") || word.find('=') != std::string_view::npos)
+                continue;
+            const auto& current = node_list_[node_index];
+            auto iter = std::lower_bound(current.name_list.begin(), current.name_list.end(), word);
+            if (iter != current.name_list.end() && *iter == word)
+            {
+                const auto child = current.child_list[static_cast<std::size_t>(iter - current.name_list.begin())];
+                if (child != no_child)
+                    node_index = child;
+            }
+        }
+
+        const auto& current = node_list_[node_index];
+        for (auto iter = std::lower_bound(current.name_list.begin(), current.name_list.end(), partial);
+             iter != current.name_list.end() && iter->starts_with(partial); ++iter)
+            candidate_list.emplace_back(*iter);
+    }
+
+    [[nodiscard]] const std::vector<node>& get_node_list() const noexcept
+    {
+        return node_list_;
+    }
+
+private:
+    void build_node(std::uint32_t node_index, const cmdparser::command_map& command_map, std::span<const std::string_view> option_names)
+    {
+        std::vector<std::pair<std::string, std::uint32_t>> entry_list;
+        entry_list.reserve(command_map.size() + option_names.size());
+        for (auto option_name : option_names)
+            entry_list.emplace_back(option_name, no_child);
+
+        for (const auto& [name, command] : command_map)
+        {
+            if (name.starts_with("__"))
+                continue;
+
+            const auto child_index = static_cast<std::uint32_t>(node_list_.size());
+            auto& child = node_list_.emplace_back();
+            child.path = node_list_[node_index].path.empty() ? name : node_list_[node_index].path + " " + name;
+            entry_list.emplace_back(name, child_index);
+
+            if (const auto* group = dynamic_cast<const command_group*>(command.get()); group != nullptr)
+                build_node(child_index, group->get_children(), group->get_option_names());
+            else
+                build_node(child_index, {}, command->get_option_names());
+        }
+
+        std::sort(entry_list.begin(), entry_list.end());
+        auto& current = node_list_[node_index];
+        current.name_list.reserve(entry_list.size());
+        current.child_list.reserve(entry_list.size());
+        for (auto& [name, child] : entry_list)
+        {
+            current.name_list.push_back(std::move(name));
+            current.child_list.push_back(child);
+        }
+    }
+
+    std::vector<node> node_list_;
+};
+
+/**
+ * @brief The "__complete" command, e.g. `tool __complete db com` prints the candidates completing "com" after "db",
+ * one per line. Register it with `parser.add(std::make_unique<lot::completion_command>())` after the other commands,
+ * the index is built from the command tree on the first call and reused by later calls
+ */
+struct completion_command : basic_command
+{
+    // Receives the candidates of one call, one per line, like the help handler of schema commands
+    using output_handler = std::function<void(std::string_view, const cmdparser&)>;
+
+    // Write the candidates to stdout by default
+    explicit completion_command(output_handler handler = &detail::print_help)
+        : output_handler_(std::move(handler))
+    {
+    }
+
+    [[nodiscard]] constexpr const char* name() const noexcept override
+    {
+        return "__complete";
+    }
+
+    void perform(const cmdparser& args) const override
+    {
+        std::call_once(index_flag_, [&] { index_.emplace(args.get_command_map()); });
+        const auto& index = *index_;
+        const auto words = std::span(args.raw()).subspan(1);
+        std::vector<std::string_view> candidate_list;
+        if (words.empty())
+            index.complete({}, {}, candidate_list);
+        else
+            index.complete(words.first(words.size() - 1), words.back(), candidate_list);
+
+        std::string output;
+        for (auto candidate : candidate_list)
+        {
+            output += candidate;
+            output += '\n';
+        }
+        output_handler_(output, args);
+    }
+
+private:
+    output_handler output_handler_;
+    mutable std::once_flag index_flag_;
+    mutable std::optional<completion_index> index_;
+};
+
+namespace detail {
+
+    inline std::string quote_shell_word(std::string_view word)
+    {
+        std::string result = "'";
+        for (char character : word)
+        {
+            if (character == '\'')
+                result += "'\\''";
+            else
+                result += character;
+        }
+        result += '\'';
+        return result;
+    }
+
+} // namespace detail
+
+/**
+ * @brief Generate a bash completion script with the whole command tree embedded, so completing doesn't start the
+ * program. Source it or install it as the completion of `program_name`. Words that are not commands or options
+ * fall back to file names
+ */
+[[nodiscard]] inline std::string format_bash_completion(const cmdparser& registry, std::string_view program_name)
+{
+    const completion_index index(registry.get_command_map());
+    const auto& node_list = index.get_node_list();
+
+    std::string function_name = "_lot_complete_";
+    for (char character : program_name)
+        function_name += (std::isalnum(static_cast<unsigned char>(character)) != 0) ? character : '_';
+
+    std::string script = "# bash completion for ";
+    script += program_name;
+    script += "\n";
+    script += function_name;
+    script += "()\n{\n";
+    script += "    local cur=\"${COMP_WORDS[COMP_CWORD]}\" path=\"\" word i\n";
+    script += "    for ((i = 1; i < COMP_CWORD; i++)); do\n";
+    script += "        word=\"${COMP_WORDS[i]}\"\n";
+    script += "        case \"$word\" in\n";
+    script += "            -*|*=*) continue ;;\n";
+    script += "        esac\n";
+    script += "        case \"$path $word\" in\n";
+    for (std::size_t node_index = 1; node_index < node_list.size(); ++node_index)
+    {
+        script += "            ";
+        script += detail::quote_shell_word(" " + node_list[node_index].path);
+        script += ") path=\"$path $word\" ;;\n";
+    }
+    script += "        esac\n";
+    script += "    done\n";
+    script += "    case \"$path\" in\n";
+    for (const auto& node : node_list)
+    {
+        if (node.name_list.empty())
+            continue;
+
+        std::string word_list;
+        for (const auto& name : node.name_list)
+        {
+            if (!word_list.empty())
+                word_list += ' ';
+            word_list += name;
+        }
+        script += "        ";
+        script += detail::quote_shell_word(node.path.empty() ? std::string() : " " + node.path);
+        script += ") COMPREPLY=($(compgen -W ";
+        script += detail::quote_shell_word(word_list);
+        script += " -- \"$cur\")) ;;\n";
+    }
+    script += "    esac\n";
+    script += "}\n";
+    script += "complete -o default -F ";
+    script += function_name;
+    script += ' ';
+    script += program_name;
+    script += "\n";
+    return script;
+}
+
+// Generate a zsh completion script, the bash script run through zsh's bashcompinit
+[[nodiscard]] inline std::string format_zsh_completion(const cmdparser& registry, std::string_view program_name)
+{
+    std::string script = "#compdef ";
+    script += program_name;
+    script += "\nautoload -U +X bashcompinit && bashcompinit\n";
+    script += format_bash_completion(registry, program_name);
+    return script;
+}
+
+} // namespace lot
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "base.h"
+#include "cmdparser.h"
+#include "mapped_file.h"
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace lot {
+
+/**
+ * @brief The argument_file_loader that maps "@file" and "@@file" arguments read-only, so their arguments and values
+ * are views into the mapping and are never copied, e.g. `parser.expand_response_files(lot::map_argument_file)`.
+ * Kept out of cmdparser.h because mapping a file pulls in the platform headers. Throw args_parse_error if the file can't be mapped
+ */
+[[nodiscard]] inline argument_file map_argument_file(std::string_view path)
+{
+    try {
+        auto file = std::make_shared<const mapped_file>(std::filesystem::path(path));
+        const std::string_view text(file->data(), file->size());
+        return { std::move(file), text };
+    } catch (const std::exception& error) {
+        throw args_parse_error("Parameter parsing error: Can't read \"" + std::string(path) + "\" : " + error.what());
+    }
+}
+
+} // namespace lot
\ No newline at end of file
@@ -1,11 +1,25 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -15,6 +29,7 @@
 namespace lot {
 
 class cmdparser;
+class command_group;
 
 struct basic_command // NOLINT(cppcoreguidelines-special-member-functions)
 {
@@ -27,6 +42,19 @@ struct basic_command // NOLINT(cppcoreguidelines-special-member-functions)
         return *info;
     }
     virtual constexpr void perform(const cmdparser& args) const = 0;
+
+    // The options the command declares, e.g. by a schema (see schema_command), used for completion
+    [[nodiscard]] virtual std::span<const std::string_view> get_option_names() const noexcept
+    {
+        return {};
+    }
+
+    // The child named `name` of a command group (see command_group), nullptr for other commands
+    [[nodiscard]] virtual const basic_command* find_subcommand(std::string_view /*name*/) const noexcept
+    {
+        return nullptr;
+    }
+
     virtual ~basic_command() = default;
 };
 
@@ -69,15 +97,424 @@ class command_not_found_error : public std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
+namespace detail {
+
+    constexpr std::uint32_t fnv1a_hash(std::string_view str) noexcept
+    {
+        std::uint32_t hash = 2166136261U;
+        for (char character : str)
+        {
+            hash ^= static_cast<std::uint8_t>(character);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    // Mix a seed into a hash, so one pass over the key serves every seed
+    constexpr std::uint32_t mix_hash(std::uint32_t hash, std::uint32_t seed) noexcept
+    {
+        hash ^= seed * 0x9E3779B9U;
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6BU;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35U;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /**
+     * @brief A minimal-collision perfect hash built at compile time (hash and displace): keys are put in buckets by
+     * their hash, every bucket gets a seed that sends all of its keys to free slots. A lookup hashes the key once,
+     * reads the seed of its bucket and compares with the single key that can be in the slot
+     */
+    template <std::size_t key_count>
+    struct perfect_hash
+    {
+        static constexpr std::size_t bucket_count = key_count == 0 ? 1 : key_count;
+        static constexpr std::size_t slot_count = std::bit_ceil(bucket_count * 2);
+
+        // Throws (i.e. fails to compile in a constant expression) when two keys are equal
+        constexpr explicit perfect_hash(const std::array<std::string_view, key_count>& key_list)
+        {
+            // Group the keys by bucket with a counting sort, bucket `b` is member_list[bucket_begin[b], bucket_begin[b + 1])
+            std::array<std::uint32_t, key_count> hash_list {};
+            std::array<std::size_t, bucket_count + 1> bucket_begin {};
+            for (std::size_t index = 0; index < key_count; ++index)
+            {
+                hash_list[index] = fnv1a_hash(key_list[index]);
+                ++bucket_begin[hash_list[index] % bucket_count + 1];
+            }
+            for (std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+                bucket_begin[bucket + 1] += bucket_begin[bucket];
+
+            std::array<std::size_t, key_count> member_list {};
+            std::array<std::size_t, bucket_count> fill_count {};
+            for (std::size_t index = 0; index < key_count; ++index)
+            {
+                const std::size_t bucket = hash_list[index] % bucket_count;
+                member_list[bucket_begin[bucket] + fill_count[bucket]++] = index;
+            }
+
+            // Place the biggest buckets first, while most slots are still free
+            std::array<std::size_t, bucket_count> bucket_order {};
+            for (std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+                bucket_order[bucket] = bucket;
+            std::sort(bucket_order.begin(), bucket_order.end(), [&](std::size_t left, std::size_t right) { return fill_count[left] > fill_count[right]; });
+
+            for (std::size_t bucket : bucket_order)
+            {
+                const std::size_t begin = bucket_begin[bucket];
+                const std::size_t end = bucket_begin[bucket + 1];
+                if (begin == end)
+                    break;
+
+                // Equal keys always share a bucket
+                for (std::size_t member = begin; member < end; ++member)
+                    for (std::size_t other = begin; other < member; ++other)
+                        if (key_list[member_list[other]] == key_list[member_list[member]])
+                            throw std::invalid_argument("static_command_table has duplicate command names");
+
+                for (std::uint32_t seed = 1;; ++seed)
+                {
+                    if (seed == 0x100000U)
+                        throw std::invalid_argument("static_command_table can't build the perfect hash");
+
+                    std::size_t member = begin;
+                    for (; member < end; ++member)
+                    {
+                        const std::size_t slot = mix_hash(hash_list[member_list[member]], seed) & (slot_count - 1);
+                        if (slot_list[slot] != 0)
+                            break;
+                        slot_list[slot] = static_cast<std::uint32_t>(member_list[member] + 1);
+                    }
+                    if (member == end)
+                    {
+                        seed_list[bucket] = seed;
+                        break;
+                    }
+
+                    // Undo the partial placement and try the next seed
+                    for (std::size_t placed = begin; placed < member; ++placed)
+                        slot_list[mix_hash(hash_list[member_list[placed]], seed) & (slot_count - 1)] = 0;
+                }
+            }
+        }
+
+        // Index of the key in `key_list`, or key_count if it isn't there
+        [[nodiscard]] constexpr std::size_t find(std::string_view key, const std::array<std::string_view, key_count>& key_list) const noexcept
+        {
+            const std::uint32_t hash = fnv1a_hash(key);
+            const std::uint32_t slot_value = slot_list[mix_hash(hash, seed_list[hash % bucket_count]) & (slot_count - 1)];
+            if (slot_value == 0 || key_list[slot_value - 1] != key)
+                return key_count;
+            return slot_value - 1;
+        }
+
+        std::array<std::uint32_t, bucket_count> seed_list {};
+        std::array<std::uint32_t, slot_count> slot_list {}; // Index of the key plus one, 0 for an empty slot
+    };
+
+    // Allows looking up std::string keys by std::string_view without building a std::string
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] std::size_t operator()(std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view> {}(str);
+        }
+    };
+
+    /**
+     * @brief Convert the value of an argument, numbers go through std::from_chars and must use the whole value.
+     * `has_value` is false for an option without "=value", which only converts to bool (true)
+     */
+    template <typename T>
+    T convert_argument(std::string_view key, std::string_view value, bool has_value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            if (!has_value || value == "true" || value == "1" || value == "yes" || value == "on")
+                return true;
+            if (value == "false" || value == "0" || value == "no" || value == "off")
+                return false;
+        } else {
+            if (!has_value)
+                throw args_parse_error("Parameter parsing error: \"" + std::string(key) + "\" requires a value");
+
+            if constexpr (std::is_same_v<T, std::string_view>)
+            {
+                return value;
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                return std::string(value);
+            } else {
+                static_assert(std::is_arithmetic_v<T>, "T must be an arithmetic type, std::string or std::string_view!");
+                T result {};
+                auto [end_ptr, error_code] = std::from_chars(value.data(), value.data() + value.size(), result);
+                if (error_code == std::errc {} && end_ptr == value.data() + value.size())
+                    return result;
+            }
+        }
+
+        throw args_parse_error("Parameter parsing error: \"" + std::string(key) + "=" + std::string(value) + "\", the value is invalid");
+    }
+
+    /**
+     * @brief Find the next argument of a response file starting at `pos`, return a view with nullptr data at the end.
+     * Arguments are separated by whitespace. An argument that starts with a single or double quote ends at the
+     * matching quote and keeps its whitespace, e.g. "--name=a b". There are no escapes, so the view always points
+     * into the text. A '#' at the start of an argument comments out the rest of the line
+     */
+    inline std::string_view next_response_token(std::string_view text, std::size_t& pos) noexcept
+    {
+        auto is_space = [](char character) { return character == ' ' || character == '\t' || character == '\r' || character == '\n'; };
+        while (pos < text.size())
+        {
+            if (is_space(text[pos]))
+            {
+                ++pos;
+                continue;
+            }
+            if (text[pos] == '#')
+            {
+                pos = text.find('\n', pos);
+                if (pos == std::string_view::npos)
+                    pos = text.size();
+                continue;
+            }
+
+            const char quote = text[pos];
+            if (quote == '"' || quote == '\'')
+            {
+                const auto quote_end = text.find(quote, pos + 1);
+                if (quote_end != std::string_view::npos)
+                {
+                    auto token = text.substr(pos + 1, quote_end - pos - 1);
+                    pos = quote_end + 1;
+                    return token;
+                }
+            }
+
+            const std::size_t begin = pos;
+            while (pos < text.size() && !is_space(text[pos]))
+                ++pos;
+            return text.substr(begin, pos - begin);
+        }
+        return {};
+    }
+
+} // namespace detail
+
+/**
+ * @brief The contents of an "@file" or "@@file" argument, `text` stays valid while `owner` is alive.
+ * The parser doesn't read files itself, an argument_file_loader such as lot::map_argument_file (cmdfile.h) does
+ */
+struct argument_file
+{
+    std::shared_ptr<const void> owner;
+    std::string_view text;
+};
+
+// Load the argument file at `path`, throw args_parse_error if it can't be read
+using argument_file_loader = std::function<argument_file(std::string_view path)>;
+
+/**
+ * @brief The values of an "@@file" argument (see cmdparser::expand_value_streams), read lazily from the loaded file. Values are split like
+ * response files (see detail::next_response_token) and the views point into the file, so millions of values
+ * can be iterated without building a list
+ */
+class value_stream
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+
+        iterator(std::string_view text) : text_(text)
+        {
+            ++*this;
+        }
+
+        [[nodiscard]] reference operator*() const noexcept
+        {
+            return current_;
+        }
+
+        [[nodiscard]] pointer operator->() const noexcept
+        {
+            return &current_;
+        }
+
+        iterator& operator++() noexcept
+        {
+            current_ = detail::next_response_token(text_, pos_);
+            return *this;
+        }
+
+        iterator operator++(int) noexcept
+        {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        [[nodiscard]] bool operator==(const iterator& other) const noexcept
+        {
+            return current_.data() == other.current_.data();
+        }
+
+        [[nodiscard]] bool operator==(std::default_sentinel_t /*sentinel*/) const noexcept
+        {
+            return current_.data() == nullptr;
+        }
+
+    private:
+        std::string_view text_;
+        std::size_t pos_ = 0;
+        std::string_view current_;
+    };
+
+    explicit value_stream(argument_file file) : file_(std::move(file))
+    {
+    }
+
+    [[nodiscard]] iterator begin() const noexcept
+    {
+        return { text() };
+    }
+
+    [[nodiscard]] std::default_sentinel_t end() const noexcept
+    {
+        return {};
+    }
+
+    // The whole file
+    [[nodiscard]] std::string_view text() const noexcept
+    {
+        return file_.text;
+    }
+
+private:
+    argument_file file_;
+};
+
+/**
+ * @brief Parse the arguments of one command line and dispatch it to a registered command.
+ * Parsers are not copyable, other parsers dispatch to the same commands through `shared_registry`, e.g. one per thread
+ */
 class cmdparser
 {
 public:
-    cmdparser(int argc, char* argv[])
+    using command_map = std::unordered_map<std::string, std::unique_ptr<basic_command>, detail::string_hash, std::equal_to<>>;
+
+    // One level of the command path, e.g. "db" and "compact" in "db --verbose compact --fast"
+    struct command_level
+    {
+        std::string_view name;
+        const basic_command* command; // nullptr if the command isn't registered
+        std::size_t raw_begin;        // The arguments owned by the level are raw()[raw_begin, raw_end)
+        std::size_t raw_end;
+    };
+
+    /**
+     * @param resource Memory of the argument and parse result lists, which are sized from `argc` up front. With e.g. a
+     * std::pmr::monotonic_buffer_resource over a stack buffer, a successful `parse` and `exec` don't touch the heap
+     */
+    cmdparser(int argc, char* argv[], std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : cmdparser(resource)
     {
+        raw_.reserve(static_cast<std::size_t>((std::max)(argc - 1, 0)));
         for (int i = 1; i < argc; ++i)
             raw_.emplace_back(argv[i]);
     }
 
+    // Arguments without the program name, the first one is the command name
+    explicit cmdparser(std::span<const std::string_view> args, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : cmdparser(resource)
+    {
+        raw_.assign(args.begin(), args.end());
+    }
+
+    /**
+     * @brief A parser without arguments that dispatches to the commands of another parser (see `shared_registry`),
+     * it can't register commands itself. Take the command lines with `reset`
+     */
+    explicit cmdparser(std::shared_ptr<const command_map> registry, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : cmdparser(resource, std::move(registry))
+    {
+    }
+
+    cmdparser(const cmdparser&) = delete;
+    cmdparser& operator=(const cmdparser&) = delete;
+    cmdparser(cmdparser&&) noexcept = default;
+    cmdparser& operator=(cmdparser&&) = default;
+    ~cmdparser() = default;
+
+    /**
+     * @brief Drop the parse results and take another command line, the registered commands are kept
+     * and the memory of the previous results is reused
+     */
+    cmdparser& reset(std::span<const std::string_view> args)
+    {
+        raw_.assign(args.begin(), args.end());
+        command_name_ = {};
+        option_list_.clear();
+        value_list_.clear();
+        value_pair_list_.clear();
+        option_pair_list_.clear();
+        argument_list_.clear();
+        command_path_.clear();
+        value_stream_list_.clear();
+        response_file_list_.clear();
+        is_parsed_ = false;
+        is_vaild_ = false;
+        return *this;
+    }
+
+    /**
+     * @brief Replace every "@file" argument by the arguments in the file, call it before `parse`, e.g.
+     * `parser.expand_response_files(lot::map_argument_file)`. A file can name other response files up to `max_depth`
+     * levels. The loaded files are kept by the parser, the arguments are views into them and are never copied.
+     * Throw args_parse_error if a file can't be read
+     */
+    cmdparser& expand_response_files(const argument_file_loader& loader, std::size_t max_depth = 8)
+    {
+        lo_assert(!is_parsed_);
+        if (std::none_of(raw_.begin(), raw_.end(), is_response_file))
+            return *this;
+
+        std::pmr::vector<std::string_view> expanded_list(raw_.get_allocator());
+        expanded_list.reserve(raw_.size());
+        for (auto item : raw_)
+            append_argument(expanded_list, item, loader, max_depth);
+        raw_.swap(expanded_list);
+        return *this;
+    }
+
+    /**
+     * @brief Let `parse` read every "@@file" argument through `loader` as a value stream (see value_stream) instead of
+     * a pure value. Off by default and with an empty loader, so "@@name" stays an ordinary value unless the program
+     * asks for it. Kept by `reset`
+     */
+    cmdparser& expand_value_streams(argument_file_loader loader)
+    {
+        lo_assert(!is_parsed_);
+        value_stream_loader_ = std::move(loader);
+        return *this;
+    }
+
+    /**
+     * @brief Split the arguments into options, key-value pairs and pure values in one pass. While the current command
+     * is a command_group, a pure value naming one of its children is consumed as the next level of the command path
+     * instead, the arguments before it belong to the group, e.g. "db --verbose compact --fast" dispatches to "compact"
+     */
     void parse()
     {
         lo_assert(!is_parsed_);
@@ -87,6 +524,17 @@ public:
             throw args_parse_error("Parameter parsing error: Requires a parameter to specify the command");
 
         command_name_ = raw_[0];
+        const auto command_iter = command_map_->find(command_name_);
+        const basic_command* current_command = command_iter != command_map_->cend() ? command_iter->second.get() : nullptr;
+        command_path_.reserve(raw_.size());
+        command_path_.push_back({ command_name_, current_command, 1, raw_.size() });
+
+        // Every list gets at most one entry per argument, reserve once instead of growing
+        option_list_.reserve(raw_.size());
+        value_list_.reserve(raw_.size());
+        value_pair_list_.reserve(raw_.size());
+        option_pair_list_.reserve(raw_.size());
+        argument_list_.reserve(raw_.size());
 
         for (auto iter = ++raw_.begin(); iter != raw_.end(); ++iter)
         {
@@ -100,6 +548,7 @@ public:
                 std::string_view key = item.substr(0, equal_pos);
                 std::string_view value = item.substr(equal_pos + 1);
                 option_pair_list_.emplace_back(key, value);
+                argument_list_.push_back({ key, value, true, current_level(), 0 });
                 continue;
             }
 
@@ -107,6 +556,14 @@ public:
             if (item.size() >= 3 && item.starts_with("--"))
             {
                 option_list_.push_back(item);
+                argument_list_.push_back({ item, {}, false, current_level(), 0 });
+                continue;
+            }
+
+            // current_item is a value stream likes "@@file", see expand_value_streams
+            if (value_stream_loader_ != nullptr && item.size() > 2 && item.starts_with("@@"))
+            {
+                value_stream_list_.emplace_back(value_stream_loader_(item.substr(2)));
                 continue;
             }
 
@@ -117,15 +574,30 @@ public:
                 std::string_view key = item.substr(0, equal_pos);
                 std::string_view value = item.substr(equal_pos + 1);
                 value_pair_list_.emplace_back(key, value);
+                argument_list_.push_back({ key, value, true, current_level(), 0 });
                 continue;
             }
 
+            // current_item is a subcommand of the current command group
+            if (current_command != nullptr)
+            {
+                if (const auto* subcommand = current_command->find_subcommand(item); subcommand != nullptr)
+                {
+                    const auto raw_index = static_cast<std::size_t>(iter - raw_.begin());
+                    command_path_.back().raw_end = raw_index;
+                    command_path_.push_back({ item, subcommand, raw_index + 1, raw_.size() });
+                    current_command = subcommand;
+                    continue;
+                }
+            }
+
             // current_item is pure value
             value_list_.emplace_back(item);
 
             // throw args_parse_error("Parameter parsing error:  \"" + std::string(item) + "\", which isn't one of option(--option), key-value pair(key=value), pure value(value)");
         }
 
+        build_argument_index();
         is_vaild_ = true;
     }
 
@@ -133,31 +605,49 @@ public:
     {
         lo_assert(is_parsed_);
 
-        auto cmd_name = std::string(command_name_);
-        auto iter = command_map_.find(cmd_name);
+        const auto* command = command_path_.back().command;
 
-        if (iter == command_map_.cend())
-            throw command_not_found_error("Unknown command : " + cmd_name);
+        if (command == nullptr)
+            throw command_not_found_error("Unknown command : " + std::string(command_name_));
 
-        iter->second->perform(*this);
+        command->perform(*this);
+    }
+
+    // Dispatch through a static_command_table, no allocation and no virtual call
+    template <typename CommandTable>
+    void exec() const
+    {
+        lo_assert(is_parsed_);
+        CommandTable::perform(*this);
     }
 
     cmdparser& add(std::unique_ptr<basic_command> command)
     {
-        lo_assert(!is_parsed_);
-        command_map_[command->name()] = std::move(command);
+        get_mutable_command_map()[command->name()] = std::move(command);
         return *this;
     }
 
     template <auto handler, auto info_handler = nullptr>
     cmdparser& add(const std::string& name)
     {
-        lo_assert(!is_parsed_);
-        command_map_[name] = std::make_unique<lambda_command<handler, info_handler>>(name);
+        get_mutable_command_map()[name] = std::make_unique<lambda_command<handler, info_handler>>(name);
         return *this;
     }
 
-    [[nodiscard]] const std::unordered_map<std::string, std::unique_ptr<basic_command>>& get_command_map() const noexcept
+    // Add an empty command group and return it to add the subcommands, e.g. `parser.add_group("db").add<compact>("compact")`
+    command_group& add_group(const std::string& name);
+
+    [[nodiscard]] const command_map& get_command_map() const noexcept
+    {
+        return *command_map_;
+    }
+
+    /**
+     * @brief A read-only handle of the registered commands for other parsers, e.g. `cmdparser worker(parser.shared_registry())`.
+     * While a handle is alive `add` and `add_group` throw std::logic_error, so register every command (the children of
+     * groups too) before sharing
+     */
+    [[nodiscard]] std::shared_ptr<const command_map> shared_registry() const noexcept
     {
         return command_map_;
     }
@@ -168,7 +658,7 @@ public:
         return is_vaild_;
     }
 
-    [[nodiscard]] const std::vector<std::string_view>& raw() const noexcept
+    [[nodiscard]] const std::pmr::vector<std::string_view>& raw() const noexcept
     {
         lo_assert(is_parsed_);
         return raw_;
@@ -180,43 +670,681 @@ public:
         return command_name_;
     }
 
-    // Option pair likes "--option=value", e.g. "--password=123"
-    [[nodiscard]] const std::vector<std::pair<std::string_view, std::string_view>>& get_option_pair_list() const noexcept
+    // The root command and the subcommands dispatched to, the last level is the command that `exec` performs
+    [[nodiscard]] const std::pmr::vector<command_level>& get_command_path() const noexcept
+    {
+        lo_assert(is_parsed_);
+        return command_path_;
+    }
+
+    // The arguments owned by the performed command, i.e. those after the last subcommand name
+    [[nodiscard]] std::span<const std::string_view> get_command_args() const noexcept
+    {
+        lo_assert(is_parsed_);
+        const auto& level = command_path_.back();
+        return std::span(raw_).subspan(level.raw_begin, level.raw_end - level.raw_begin);
+    }
+
+    // Option pair likes "--option=value", e.g. "--password=123". This list and the ones below span every level of the command path
+    [[nodiscard]] const std::pmr::vector<std::pair<std::string_view, std::string_view>>& get_option_pair_list() const noexcept
     {
         lo_assert(is_parsed_);
         return option_pair_list_;
     }
 
     // Option is start with "--", e.g. "--help"
-    [[nodiscard]] const std::vector<std::string_view>& get_option_list() const noexcept
+    [[nodiscard]] const std::pmr::vector<std::string_view>& get_option_list() const noexcept
     {
         lo_assert(is_parsed_);
         return option_list_;
     }
 
     // Item pair likes "key=value", e.g. "var1=123"
-    [[nodiscard]] const std::vector<std::pair<std::string_view, std::string_view>>& get_value_pair_list() const noexcept
+    [[nodiscard]] const std::pmr::vector<std::pair<std::string_view, std::string_view>>& get_value_pair_list() const noexcept
     {
         lo_assert(is_parsed_);
         return value_pair_list_;
     }
 
     // Value likes "value", e.g. "123"
-    [[nodiscard]] const std::vector<std::string_view>& get_value_list() const noexcept
+    [[nodiscard]] const std::pmr::vector<std::string_view>& get_value_list() const noexcept
     {
         lo_assert(is_parsed_);
         return value_list_;
     }
 
+    // Value streams likes "@@file" in command line order, empty unless expand_value_streams was called
+    [[nodiscard]] const std::pmr::vector<value_stream>& get_value_stream_list() const noexcept
+    {
+        lo_assert(is_parsed_);
+        return value_stream_list_;
+    }
+
+    // Call `func(std::string_view)` for every pure value, then for every value of the value streams
+    template <typename Func>
+    void for_each_value(Func&& func) const
+    {
+        lo_assert(is_parsed_);
+        for (auto value : value_list_)
+            func(value);
+        for (const auto& stream : value_stream_list_)
+            for (auto value : stream)
+                func(value);
+    }
+
+    /**
+     * @brief Whether the option or key appeared among the arguments of the performed command, e.g. "--help" matches
+     * "--help" and "--help=all", "var1" matches "var1=123". In "tool --verbose sub --fast" the handler of "sub" sees
+     * "--fast" but not "--verbose", which belongs to level 0 of the command path, see the overloads taking a level
+     */
+    [[nodiscard]] bool has_option(std::string_view key) const noexcept
+    {
+        lo_assert(is_parsed_);
+        return has_option(command_path_.size() - 1, key);
+    }
+
+    // Like `has_option(key)` for the arguments of one level of the command path (see get_command_path)
+    [[nodiscard]] bool has_option(std::size_t level, std::string_view key) const noexcept
+    {
+        lo_assert(is_parsed_ && level < command_path_.size());
+        return find_argument(level, key) != nullptr;
+    }
+
+    /**
+     * @brief The value of the last occurrence of an option pair or key-value pair of the performed command converted
+     * to T, e.g. `get<int>("--jobs")`. Throw args_parse_error if the key is missing or the value can't be converted
+     *
+     * @tparam T Arithmetic type, std::string or std::string_view, an option without value is `true` as bool
+     */
+    template <typename T = std::string_view>
+    [[nodiscard]] T get(std::string_view key) const
+    {
+        lo_assert(is_parsed_);
+        return get<T>(command_path_.size() - 1, key);
+    }
+
+    // Like `get<T>(key)` for the arguments of one level of the command path, e.g. `get<bool>(0, "--verbose")` in a subcommand
+    template <typename T = std::string_view>
+    [[nodiscard]] T get(std::size_t level, std::string_view key) const
+    {
+        lo_assert(is_parsed_ && level < command_path_.size());
+        const auto* slot = find_argument(level, key);
+        if (slot == nullptr)
+            throw args_parse_error("Parameter parsing error: Requires \"" + std::string(key) + "\"");
+
+        const auto& entry = argument_list_[slot->last];
+        return detail::convert_argument<T>(key, entry.value, entry.has_value);
+    }
+
+    // Like `get<T>(key)` but return `default_value` if the key is missing
+    template <typename T>
+    [[nodiscard]] T get(std::string_view key, T default_value) const
+    {
+        lo_assert(is_parsed_);
+        return get<T>(command_path_.size() - 1, key, std::move(default_value));
+    }
+
+    template <typename T>
+    [[nodiscard]] T get(std::size_t level, std::string_view key, T default_value) const
+    {
+        lo_assert(is_parsed_ && level < command_path_.size());
+        const auto* slot = find_argument(level, key);
+        if (slot == nullptr)
+            return default_value;
+
+        const auto& entry = argument_list_[slot->last];
+        return detail::convert_argument<T>(key, entry.value, entry.has_value);
+    }
+
+    // Values of every occurrence of the key among the arguments of the performed command in command line order
+    template <typename T = std::string_view>
+    [[nodiscard]] std::vector<T> get_all(std::string_view key) const
+    {
+        lo_assert(is_parsed_);
+        return get_all<T>(command_path_.size() - 1, key);
+    }
+
+    template <typename T = std::string_view>
+    [[nodiscard]] std::vector<T> get_all(std::size_t level, std::string_view key) const
+    {
+        lo_assert(is_parsed_ && level < command_path_.size());
+        const auto* slot = find_argument(level, key);
+        std::vector<T> result;
+        if (slot == nullptr)
+            return result;
+
+        result.reserve(slot->count);
+        for (std::uint32_t index = slot->first, remain = slot->count; remain != 0; index = argument_list_[index].next, --remain)
+            result.push_back(detail::convert_argument<T>(key, argument_list_[index].value, argument_list_[index].has_value));
+        return result;
+    }
+
 private:
+    // Own an empty registry if `registry` is nullptr
+    explicit cmdparser(std::pmr::memory_resource* resource, std::shared_ptr<const command_map> registry = nullptr)
+        : option_list_(resource), value_list_(resource), raw_(resource), value_pair_list_(resource), option_pair_list_(resource),
+          argument_list_(resource), argument_slot_list_(resource), command_path_(resource), value_stream_list_(resource),
+          is_own_command_map_(registry == nullptr),
+          command_map_(is_own_command_map_ ? std::make_shared<command_map>() : std::move(registry))
+    {
+    }
+
+    // The registry can only change while this parser owns it and no other parser shares it
+    command_map& get_mutable_command_map()
+    {
+        lo_assert(!is_parsed_);
+        if (!is_own_command_map_ || command_map_.use_count() != 1)
+            throw std::logic_error("cmdparser add fails : the registered commands are shared");
+        // An owned registry was created non-const by the constructor
+        return const_cast<command_map&>(*command_map_); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+    }
+
+    static bool is_response_file(std::string_view item) noexcept
+    {
+        return item.size() > 1 && item[0] == '@' && item[1] != '@';
+    }
+
+    void append_argument(std::pmr::vector<std::string_view>& expanded_list, std::string_view item, const argument_file_loader& loader, std::size_t remain_depth)
+    {
+        if (!is_response_file(item))
+        {
+            expanded_list.push_back(item);
+            return;
+        }
+        if (remain_depth == 0)
+            throw args_parse_error("Parameter parsing error: Response files are nested too deeply at \"" + std::string(item) + "\"");
+
+        auto file = loader(item.substr(1));
+        response_file_list_.push_back(std::move(file.owner));
+        std::size_t pos = 0;
+        for (auto token = detail::next_response_token(file.text, pos); token.data() != nullptr; token = detail::next_response_token(file.text, pos))
+            append_argument(expanded_list, token, loader, remain_depth - 1);
+    }
+
+    struct argument_entry
+    {
+        std::string_view key;
+        std::string_view value;
+        bool has_value;
+        std::uint32_t level; // Index of the command level owning the entry
+        std::uint32_t next;  // Index of the next entry with the same key and level
+    };
+
+    // The entries of one key at one level, linked in command line order through `argument_entry::next`, `count == 0` for an empty slot
+    struct argument_slot
+    {
+        std::uint32_t first = 0;
+        std::uint32_t last = 0;
+        std::uint32_t count = 0;
+    };
+
+    [[nodiscard]] std::uint32_t current_level() const noexcept
+    {
+        return static_cast<std::uint32_t>(command_path_.size() - 1);
+    }
+
+    [[nodiscard]] static std::size_t get_argument_hash(std::size_t level, std::string_view key) noexcept
+    {
+        return detail::fnv1a_hash(key) + level * 16777619U;
+    }
+
+    [[nodiscard]] bool is_same_argument(std::uint32_t index, std::size_t level, std::string_view key) const noexcept
+    {
+        return argument_list_[index].level == level && argument_list_[index].key == key;
+    }
+
+    // Hash every (level, key) into an open addressing table and link the entries of each, nothing is sorted or allocated
+    // besides the table itself
+    void build_argument_index()
+    {
+        argument_slot_list_.assign(std::bit_ceil(argument_list_.size() * 2 + 1), argument_slot {});
+
+        const std::size_t mask = argument_slot_list_.size() - 1;
+        for (std::uint32_t index = 0; index < argument_list_.size(); ++index)
+        {
+            const std::string_view key = argument_list_[index].key;
+            const std::size_t level = argument_list_[index].level;
+            std::size_t slot = get_argument_hash(level, key) & mask;
+            while (argument_slot_list_[slot].count != 0 && !is_same_argument(argument_slot_list_[slot].first, level, key))
+                slot = (slot + 1) & mask;
+
+            auto& entry_slot = argument_slot_list_[slot];
+            if (entry_slot.count == 0)
+                entry_slot.first = index;
+            else
+                argument_list_[entry_slot.last].next = index;
+            entry_slot.last = index;
+            ++entry_slot.count;
+        }
+    }
+
+    // Return nullptr if the key is missing at the level
+    [[nodiscard]] const argument_slot* find_argument(std::size_t level, std::string_view key) const noexcept
+    {
+        if (argument_slot_list_.empty())
+            return nullptr;
+
+        const std::size_t mask = argument_slot_list_.size() - 1;
+        for (std::size_t slot = get_argument_hash(level, key) & mask; argument_slot_list_[slot].count != 0; slot = (slot + 1) & mask)
+            if (is_same_argument(argument_slot_list_[slot].first, level, key))
+                return &argument_slot_list_[slot];
+        return nullptr;
+    }
+
     bool is_vaild_ = false;
     bool is_parsed_ = false;
     std::string_view command_name_;
-    std::vector<std::string_view> option_list_;
-    std::vector<std::string_view> value_list_;
-    std::vector<std::string_view> raw_;
-    std::vector<std::pair<std::string_view, std::string_view>> value_pair_list_;
-    std::vector<std::pair<std::string_view, std::string_view>> option_pair_list_;
-    std::unordered_map<std::string, std::unique_ptr<basic_command>> command_map_;
+    std::pmr::vector<std::string_view> option_list_;
+    std::pmr::vector<std::string_view> value_list_;
+    std::pmr::vector<std::string_view> raw_;
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> value_pair_list_;
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> option_pair_list_;
+    std::pmr::vector<argument_entry> argument_list_;
+    std::pmr::vector<argument_slot> argument_slot_list_;
+    std::pmr::vector<command_level> command_path_;
+    std::pmr::vector<value_stream> value_stream_list_;
+    argument_file_loader value_stream_loader_;
+    std::vector<std::shared_ptr<const void>> response_file_list_; // Keeps the response files that raw_ points into
+    bool is_own_command_map_; // false for a parser built on a shared registry
+    std::shared_ptr<const command_map> command_map_;
+};
+
+/**
+ * @brief A command with subcommands, e.g. "db" in "tool db compact --fast". Groups nest, parse walks the tree while
+ * splitting the arguments (see cmdparser::parse) and exec performs the last command reached. Handlers of
+ * subcommands receive the whole parse result, `get` and `has_option` read their own arguments and the overloads
+ * taking a level read the options of their parent groups, e.g. `args.get<bool>(0, "--verbose", false)`.
+ * Performing the group itself means no subcommand was given and throws command_not_found_error
+ */
+class command_group : public basic_command
+{
+public:
+    explicit command_group(std::string name) : name_(std::move(name))
+    {
+    }
+
+    [[nodiscard]] constexpr const char* name() const noexcept override
+    {
+        return name_.c_str();
+    }
+
+    void perform(const cmdparser& args) const override
+    {
+        const auto& level = args.get_command_path().back();
+        const auto& raw = args.raw();
+        for (auto index = level.raw_begin; index != level.raw_end; ++index)
+            if (!raw[index].starts_with("--") && raw[index].find('=') == std::string_view::npos)
+                throw command_not_found_error("Unknown command : " + name_ + " " + std::string(raw[index]));
+        throw command_not_found_error("Requires a subcommand of " + name_);
+    }
+
+    [[nodiscard]] const basic_command* find_subcommand(std::string_view name) const noexcept override
+    {
+        auto iter = children_.find(name);
+        return iter != children_.cend() ? iter->second.get() : nullptr;
+    }
+
+    command_group& add(std::unique_ptr<basic_command> command)
+    {
+        children_[command->name()] = std::move(command);
+        return *this;
+    }
+
+    template <auto handler, auto info_handler = nullptr>
+    command_group& add(const std::string& name)
+    {
+        children_[name] = std::make_unique<lambda_command<handler, info_handler>>(name);
+        return *this;
+    }
+
+    // Add an empty child group and return it, e.g. `group.add_group("index").add<rebuild>("rebuild")`
+    command_group& add_group(const std::string& name)
+    {
+        auto group = std::make_unique<command_group>(name);
+        auto& result = *group;
+        children_[name] = std::move(group);
+        return result;
+    }
+
+    [[nodiscard]] const cmdparser::command_map& get_children() const noexcept
+    {
+        return children_;
+    }
+
+private:
+    std::string name_;
+    cmdparser::command_map children_;
+};
+
+inline command_group& cmdparser::add_group(const std::string& name)
+{
+    auto& target = get_mutable_command_map();
+    auto group = std::make_unique<command_group>(name);
+    auto& result = *group;
+    target[name] = std::move(group);
+    return result;
+}
+
+/**
+ * @brief A fixed size string that can be used as a template parameter, e.g. `static_command<"name", handler>`
+ */
+template <std::size_t size>
+struct fixed_string
+{
+    constexpr fixed_string(const char (&str)[size]) noexcept // NOLINT(google-explicit-constructor, cppcoreguidelines-avoid-c-arrays)
+    {
+        std::copy_n(str, size, data);
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const noexcept
+    {
+        return { data, size - 1 };
+    }
+
+    char data[size] {}; // NOLINT(cppcoreguidelines-avoid-c-arrays)
 };
+
+// An entry of static_command_table, like lambda_command but without heap object and virtual call
+template <fixed_string command_name, auto handler>
+struct static_command
+{
+    static constexpr std::string_view name = command_name.view();
+
+    static constexpr void perform(const cmdparser& args)
+    {
+        handler(args);
+    }
+};
+
+/**
+ * @brief A command table fixed at compile time, e.g.
+ * `using commands = static_command_table<static_command<"add", add_handler>, static_command<"del", del_handler>>;`
+ * then `parser.exec<commands>()`. The perfect hash is built by the compiler, so there is no registration at startup,
+ * and a dispatch is one hash of the command name, one comparison and a direct call
+ */
+template <typename... Commands>
+struct static_command_table
+{
+    using perform_function = void (*)(const cmdparser&);
+
+    static constexpr std::array<std::string_view, sizeof...(Commands)> name_list = { Commands::name... };
+    static constexpr std::array<perform_function, sizeof...(Commands)> perform_list = { &Commands::perform... };
+    static constexpr detail::perfect_hash<sizeof...(Commands)> hash { name_list };
+
+    // Return nullptr if there is no command called `name`
+    [[nodiscard]] static constexpr perform_function find(std::string_view name) noexcept
+    {
+        const std::size_t index = hash.find(name, name_list);
+        return index == sizeof...(Commands) ? nullptr : perform_list[index];
+    }
+
+    [[nodiscard]] static constexpr bool contains(std::string_view name) noexcept
+    {
+        return hash.find(name, name_list) != sizeof...(Commands);
+    }
+
+    static void perform(const cmdparser& args)
+    {
+        auto* perform_func = find(args.get_command_name());
+        if (perform_func == nullptr)
+            throw command_not_found_error("Unknown command : " + std::string(args.get_command_name()));
+
+        perform_func(args);
+    }
+};
+
+namespace detail {
+
+    template <typename>
+    struct member_pointer_traits;
+
+    template <typename Class, typename Member>
+    struct member_pointer_traits<Member Class::*>
+    {
+        using class_type = Class;
+        using value_type = Member;
+    };
+
+} // namespace detail
+
+/**
+ * @brief One entry of an option schema, binds an option name to a member of the result struct
+ *
+ * @tparam member Pointer to the member that receives the value, its type must be arithmetic or std::string_view
+ */
+template <auto member>
+struct option
+{
+    using result_type = typename detail::member_pointer_traits<decltype(member)>::class_type;
+    using value_type = typename detail::member_pointer_traits<decltype(member)>::value_type;
+    static constexpr auto member_pointer = member;
+
+    std::string_view name;                                // "--name" for options, "name" for key-value pairs
+    std::string_view description;                         // Shown by --help
+    std::optional<value_type> default_value = std::nullopt; // Assigned when the option is missing
+    bool is_required = false;                             // Missing it is an error
+};
+
+namespace detail {
+
+    // The compile-time view of a schema: `Result::options` is a tuple of option<&Result::member>
+    template <typename Result>
+    struct option_schema
+    {
+        static constexpr std::size_t option_count = std::tuple_size_v<std::remove_cvref_t<decltype(Result::options)>>;
+
+        static constexpr std::array<std::string_view, option_count> name_list = std::apply(
+            [](const auto&... entry) { return std::array<std::string_view, option_count> { entry.name... }; }, Result::options);
+
+        static constexpr perfect_hash<option_count> hash { name_list };
+
+        using assign_function = void (*)(Result&, std::string_view, std::string_view, bool);
+
+        template <std::size_t index>
+        static void assign(Result& result, std::string_view key, std::string_view value, bool has_value)
+        {
+            constexpr const auto& entry = std::get<index>(Result::options);
+            using value_type = typename std::remove_cvref_t<decltype(entry)>::value_type;
+            result.*(entry.member_pointer) = convert_argument<value_type>(key, value, has_value);
+        }
+
+        static constexpr auto assign_list = []<std::size_t... index>(std::index_sequence<index...>) {
+            return std::array<assign_function, option_count> { &assign<index>... };
+        }(std::make_index_sequence<option_count>());
+    };
+
+    template <typename T>
+    void append_option_value(std::string& buffer, const T& value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            buffer += value ? "true" : "false";
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            buffer += value;
+        } else {
+            std::array<char, 64> chars {};
+            auto [end_ptr, error_code] = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+            buffer.append(chars.data(), end_ptr);
+        }
+    }
+
+    // Whether the performed command's own arguments contain "--help", those of the parent groups don't count
+    inline bool is_help_requested(const cmdparser& args) noexcept
+    {
+        const auto command_args = args.get_command_args();
+        return std::any_of(command_args.begin(), command_args.end(), [](std::string_view item) {
+            return item == "--help" || item.starts_with("--help=");
+        });
+    }
+
+    // The default help handler of schema commands and output handler of completion_command, writes the text to stdout
+    inline void print_help(std::string_view help, const cmdparser& /*args*/)
+    {
+        std::fwrite(help.data(), 1, help.size(), stdout);
+    }
+
+} // namespace detail
+
+/**
+ * @brief Fill a `Result` from the arguments in a single pass over them, e.g.
+ * @code
+ * struct copy_options
+ * {
+ *     int jobs = 1;
+ *     bool is_force = false;
+ *     std::string_view target;
+ *
+ *     static constexpr auto options = std::tuple {
+ *         lot::option<&copy_options::jobs> { "--jobs", "Number of jobs", 4 },
+ *         lot::option<&copy_options::is_force> { "--force", "Overwrite existing files" },
+ *         lot::option<&copy_options::target> { "target", "Destination directory", {}, true },
+ *     };
+ * };
+ * @endcode
+ * Option names are found by a compile-time perfect hash and assigned through a table of direct calls.
+ * Only the arguments of the performed command are read (see cmdparser::get_command_args).
+ * Throw args_parse_error for unknown options, missing required options and invalid values, pure values are not checked
+ */
+template <typename Result>
+[[nodiscard]] Result parse_options(const cmdparser& args)
+{
+    using schema = detail::option_schema<Result>;
+
+    Result result {};
+    std::array<bool, schema::option_count> seen_list {};
+    for (const std::string_view item : args.get_command_args())
+    {
+        const auto equal_pos = item.find('=');
+        const bool is_option = item.size() >= 3 && item.starts_with("--");
+        if (!is_option && equal_pos == std::string_view::npos)
+            continue; // Pure value
+
+        const std::string_view key = item.substr(0, equal_pos);
+        const bool has_value = equal_pos != std::string_view::npos;
+        const std::string_view value = has_value ? item.substr(equal_pos + 1) : std::string_view {};
+
+        const std::size_t index = schema::hash.find(key, schema::name_list);
+        if (index == schema::option_count)
+            throw args_parse_error("Parameter parsing error: Unknown option \"" + std::string(key) + "\"");
+
+        schema::assign_list[index](result, key, value, has_value);
+        seen_list[index] = true;
+    }
+
+    [&]<std::size_t... index>(std::index_sequence<index...>) {
+        ([&] {
+            constexpr const auto& entry = std::get<index>(Result::options);
+            if (seen_list[index])
+                return;
+            if (entry.is_required)
+                throw args_parse_error("Parameter parsing error: Requires \"" + std::string(entry.name) + "\"");
+            if (entry.default_value)
+                result.*(entry.member_pointer) = *entry.default_value;
+        }(), ...);
+    }(std::make_index_sequence<schema::option_count>());
+
+    return result;
+}
+
+// Generate the --help text of a schema
+template <typename Result>
+[[nodiscard]] std::string format_options_help(std::string_view command_name)
+{
+    std::string help = "Usage: ";
+    help += command_name;
+    help += " [options]\n";
+
+    std::size_t name_width = 0;
+    std::apply([&](const auto&... entry) { ((name_width = (std::max)(name_width, entry.name.size() + 8)), ...); }, Result::options);
+
+    std::apply(
+        [&](const auto&... entry) {
+            ([&] {
+                const std::size_t line_begin = help.size();
+                help += "  ";
+                help += entry.name;
+                using value_type = typename std::remove_cvref_t<decltype(entry)>::value_type;
+                if constexpr (!std::is_same_v<value_type, bool>)
+                    help += "=<value>";
+                help.append(line_begin + name_width + 4 - help.size(), ' ');
+                help += entry.description;
+                if (entry.is_required)
+                {
+                    help += " (required)";
+                } else if (entry.default_value) {
+                    help += " (default: ";
+                    detail::append_option_value(help, *entry.default_value);
+                    help += ")";
+                }
+                help += "\n";
+            }(),
+                ...);
+        },
+        Result::options);
+    return help;
+}
+
+/**
+ * @brief A command with an option schema, "--help" passes the generated help to
+ * `help_handler(std::string_view, const cmdparser&)` (stdout by default), otherwise the arguments are validated into
+ * `Result` and `handler(const Result&, const cmdparser&)` is called
+ */
+template <typename Result, auto handler, auto help_handler = &detail::print_help>
+struct schema_command : basic_command
+{
+    schema_command(std::string name) : name_(std::move(name))
+    {
+    }
+
+    [[nodiscard]] constexpr const char* name() const noexcept override
+    {
+        return name_.c_str();
+    }
+
+    // The help text as std::string, empty if it can't be allocated
+    [[nodiscard]] std::any info(const std::any* /*info*/) const noexcept override
+    {
+        try {
+            return format_options_help<Result>(name_);
+        } catch (...) {
+            return {};
+        }
+    }
+
+    [[nodiscard]] std::span<const std::string_view> get_option_names() const noexcept override
+    {
+        return detail::option_schema<Result>::name_list;
+    }
+
+    void perform(const cmdparser& args) const override
+    {
+        if (detail::is_help_requested(args))
+        {
+            help_handler(format_options_help<Result>(name_), args);
+            return;
+        }
+        handler(parse_options<Result>(args), args);
+    }
+
+private:
+    std::string name_;
+};
+
+// The static_command_table entry of a command with an option schema, see schema_command
+template <fixed_string command_name, typename Result, auto handler, auto help_handler = &detail::print_help>
+struct static_schema_command
+{
+    static constexpr std::string_view name = command_name.view();
+
+    static void perform(const cmdparser& args)
+    {
+        if (detail::is_help_requested(args))
+        {
+            help_handler(format_options_help<Result>(name), args);
+            return;
+        }
+        handler(parse_options<Result>(args), args);
+    }
+};
+
 } // namespace lot
\ No newline at end of file
@@ -1,4 +1,7 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
 #include <string_view>
 
@@ -94,4 +97,103 @@ private:
     }
 };
 
-} // namespace lot
+enum class color : std::uint8_t
+{
+    default_color = 0,
+    black,
+    red,
+    green,
+    yellow,
+    blue,
+    magenta,
+    cyan,
+    white
+};
+
+enum class text_style : std::uint8_t
+{
+    none = 0,
+    bold = 1,
+    dim = 2,
+    italic = 4,
+    underline = 8,
+    blink = 16,
+    reverse = 32
+};
+
+constexpr text_style operator|(text_style lhs, text_style rhs) noexcept
+{
+    return static_cast<text_style>(static_cast<std::uint8_t>(lhs) | static_cast<std::uint8_t>(rhs));
+}
+
+/**
+ * @brief Two bytes of display attributes for one character cell, the foreground and background colors
+ * share the first byte and the styles are bit flags in the second
+ */
+struct text_attribute
+{
+    constexpr text_attribute() = default;
+    constexpr text_attribute(color foreground, color background = color::default_color, text_style style = text_style::none) noexcept
+        : color_bits_(static_cast<std::uint8_t>(static_cast<std::uint8_t>(foreground) | static_cast<std::uint8_t>(background) << 4)), style_bits_(static_cast<std::uint8_t>(style))
+    {
+    }
+
+    [[nodiscard]] constexpr color foreground() const noexcept
+    {
+        return static_cast<color>(color_bits_ & 0x0FU);
+    }
+
+    [[nodiscard]] constexpr color background() const noexcept
+    {
+        return static_cast<color>(color_bits_ >> 4);
+    }
+
+    [[nodiscard]] constexpr text_style style() const noexcept
+    {
+        return static_cast<text_style>(style_bits_);
+    }
+
+    [[nodiscard]] constexpr bool has_style(text_style style) const noexcept
+    {
+        return (style_bits_ & static_cast<std::uint8_t>(style)) != 0;
+    }
+
+    [[nodiscard]] constexpr bool is_default() const noexcept
+    {
+        return color_bits_ == 0 && style_bits_ == 0;
+    }
+
+    // Append the SGR escape sequence that switches the terminal to this attribute, nothing when colors are off
+    void append_sgr(std::string& buffer) const
+    {
+        if (!colors::get_color_switch())
+            return;
+
+        buffer += "\033[0";
+        constexpr std::string_view style_code_list[] = { ";1", ";2", ";3", ";4", ";5", ";7" };
+        for (std::size_t index = 0; index < std::size(style_code_list); ++index)
+            if ((style_bits_ >> index & 1U) != 0)
+                buffer += style_code_list[index];
+
+        if (foreground() != color::default_color)
+        {
+            buffer += ";3";
+            buffer += static_cast<char>('0' + static_cast<int>(foreground()) - 1);
+        }
+
+        if (background() != color::default_color)
+        {
+            buffer += ";4";
+            buffer += static_cast<char>('0' + static_cast<int>(background()) - 1);
+        }
+        buffer += 'm';
+    }
+
+    friend constexpr bool operator==(const text_attribute& lhs, const text_attribute& rhs) noexcept = default;
+
+private:
+    std::uint8_t color_bits_ = 0;
+    std::uint8_t style_bits_ = 0;
+};
+
+} // namespace lot
\ No newline at end of file
@@ -3,16 +3,86 @@
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
-#include <numeric>
-#include <sstream>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace lot {
 
+namespace detail {
+
+    /**
+     * @brief The type sums and products of coordinate values are computed in: T for floating types,
+     * 64-bit integers for integral types
+     */
+    template <typename T>
+    using coordinate_accumulate_t = std::conditional_t<std::is_floating_point_v<T>, T, std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    // Call `func(std::integral_constant<std::size_t, i>)` for i in [0, count), expanded at compile time
+    template <std::size_t count, typename Func>
+    constexpr void unroll(Func&& func)
+    {
+        [&]<std::size_t... index>(std::index_sequence<index...>) {
+            (func(std::integral_constant<std::size_t, index> {}), ...);
+        }(std::make_index_sequence<count>());
+    }
+
+    // std::abs isn't constexpr before C++23
+    template <typename T>
+    [[nodiscard]] constexpr T abs_value(T value) noexcept
+    {
+        if constexpr (std::is_signed_v<T>)
+            return value < 0 ? static_cast<T>(-value) : value;
+        else
+            return value;
+    }
+
+    /**
+     * @brief std::sqrt isn't constexpr before C++26, so constant evaluation runs Newton's method from above instead,
+     * which ends within one ulp of the root. At run time this is std::sqrt
+     */
+    template <typename T>
+        requires(std::is_floating_point_v<T>)
+    [[nodiscard]] constexpr T sqrt_value(T value) noexcept
+    {
+        if (!std::is_constant_evaluated())
+            return std::sqrt(value);
+
+        if (value == 0 || value == std::numeric_limits<T>::infinity())
+            return value;
+        if (!(value > 0))
+            return std::numeric_limits<T>::quiet_NaN();
+
+        // Every step shrinks toward the root, the first one that doesn't has converged
+        T current = value > 1 ? value : T { 1 };
+        while (true)
+        {
+            const T next = (current + value / current) / 2;
+            if (next >= current)
+                return current;
+            current = next;
+        }
+    }
+
+    // Skip ASCII whitespace, std::from_chars doesn't
+    [[nodiscard]] constexpr const char* skip_space(const char* first, const char* last) noexcept
+    {
+        while (first != last && (*first == ' ' || *first == '\t' || *first == '\r' || *first == '\n' || *first == '\v' || *first == '\f'))
+            ++first;
+        return first;
+    }
+
+} // namespace detail
+
 /**
  * @brief A simple coordinate template that can represent coordinates in any dimension,
  * internally using std::array to store the coordinates
@@ -26,6 +96,10 @@ struct coordinate
     static_assert(std::is_arithmetic_v<T>, "T must be an arithmetic type!");
 
     using DataType = std::array<T, dimension>;
+    using accumulate_type = detail::coordinate_accumulate_t<T>;
+
+    // The longest text written by to_chars
+    static constexpr std::size_t max_chars = 2 + dimension * (std::is_integral_v<T> ? std::numeric_limits<T>::digits10 + 3 : 32);
 
     constexpr coordinate() = default;
     constexpr coordinate(std::initializer_list<T> val) : data()
@@ -37,68 +111,60 @@ struct coordinate
     constexpr coordinate operator-() const noexcept
     {
         coordinate temp {};
-        std::transform(data.cbegin(), data.cend(), temp.data.begin(), [](const T& val) { return -val; });
+        detail::unroll<dimension>([&](auto i) { temp.data[i] = static_cast<T>(-data[i]); });
         return temp;
     }
 
     constexpr coordinate& operator+=(const coordinate& rhs) noexcept
     {
-        std::transform(
-            data.cbegin(), data.cend(), rhs.data.cbegin(), data.begin(), [](const T& rhs, const T& lhs) constexpr { return rhs + lhs; });
+        detail::unroll<dimension>([&](auto i) { data[i] += rhs.data[i]; });
         return *this;
     }
 
     constexpr coordinate& operator-=(const coordinate& rhs) noexcept
     {
-        std::transform(
-            data.cbegin(), data.cend(), rhs.data.cbegin(), data.begin(), [](const T& rhs, const T& lhs) constexpr { return rhs - lhs; });
+        detail::unroll<dimension>([&](auto i) { data[i] -= rhs.data[i]; });
         return *this;
     }
 
+    // The length, also in constant evaluation (see detail::sqrt_value)
     [[nodiscard]] constexpr double distance() const noexcept
     {
-        return std::sqrt(distance_rough());
+        return detail::sqrt_value(static_cast<double>(distance_rough()));
     }
 
-    [[nodiscard]] constexpr std::size_t distance_rough() const noexcept
+    // The squared length, computed in accumulate_type so it neither truncates floating values nor overflows 32-bit ones
+    [[nodiscard]] constexpr accumulate_type distance_rough() const noexcept
     {
-        DataType temp;
-        std::transform(
-            data.cbegin(), data.cend(), temp.begin(), [](const T& val) constexpr { return val * val; });
-        return std::accumulate(temp.cbegin(), temp.cend(), 0);
+        accumulate_type result = 0;
+        detail::unroll<dimension>([&](auto i) { result += static_cast<accumulate_type>(data[i]) * static_cast<accumulate_type>(data[i]); });
+        return result;
     }
 
     [[nodiscard]] constexpr coordinate abs() const noexcept
     {
-        DataType temp;
-        std::transform(
-            data.cbegin(), data.cend(), temp.begin(), [](const T& val) constexpr { return std::abs(val); });
+        coordinate temp {};
+        detail::unroll<dimension>([&](auto i) { temp.data[i] = detail::abs_value(data[i]); });
         return temp;
     }
 
     friend constexpr coordinate<T, dimension> operator+(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
     {
-        coordinate<T, dimension> temp {};
-        std::transform(
-            lhs.data.cbegin(), lhs.data.cend(), rhs.data.cbegin(), temp.data.begin(), [](const T& lhs, const T& rhs) constexpr { return lhs + rhs; });
-        return temp;
+        coordinate<T, dimension> temp = lhs;
+        return temp += rhs;
     }
 
     friend constexpr coordinate<T, dimension> operator-(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
     {
-        coordinate<T, dimension> temp {};
-        std::transform(
-            lhs.data.cbegin(), lhs.data.cend(), rhs.data.cbeing(), temp.data.begin(), [](const T& lhs, const T& rhs) constexpr { return lhs - rhs; });
-        return temp;
+        coordinate<T, dimension> temp = lhs;
+        return temp -= rhs;
     }
 
     friend constexpr bool operator==(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
     {
-        std::array<bool, dimension> temp {};
-        std::transform(
-            lhs.data.cbegin(), lhs.data.cend(), rhs.data.cbegin(), temp.begin(), [](const T& lhs, const T& rhs) constexpr { return lhs == rhs; });
-        return std::all_of(
-            temp.cbegin(), temp.cend(), [](bool val) constexpr { return val; });
+        bool result = true;
+        detail::unroll<dimension>([&](auto i) { result = result && lhs.data[i] == rhs.data[i]; });
+        return result;
     }
 
     friend constexpr bool operator!=(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
@@ -108,7 +174,9 @@ struct coordinate
 
     friend std::ostream& operator<<(std::ostream& lhs, const coordinate<T, dimension>& rhs)
     {
-        return lhs << rhs.to_string();
+        std::array<char, max_chars> buffer; // NOLINT(cppcoreguidelines-pro-type-member-init)
+        const auto result = rhs.to_chars(buffer.data(), buffer.data() + buffer.size());
+        return lhs.write(buffer.data(), result.ptr - buffer.data());
     }
 
     friend std::istream& operator>>(std::istream& in_stream, coordinate<T, dimension>& rhs)
@@ -150,33 +218,226 @@ struct coordinate
         return in_stream;
     }
 
-    [[nodiscard]] std::string to_string() const
+    /**
+     * @brief Write the text likes "(1,2)" to [first, last), without allocation and independent of the locale.
+     * Floating values are written in the shortest form that reads back to the same value.
+     * Return { last, std::errc::value_too_large } if it doesn't fit, `max_chars` always fits
+     */
+    std::to_chars_result to_chars(char* first, char* last) const noexcept
     {
-        // return fmt::format("({},{})", x, y);
-        std::stringstream out;
-        out << "(";
-        out << data.at(0);
-        for (size_t i = 1; i < data.size(); i++)
+        constexpr auto too_large = std::errc::value_too_large;
+        if (first == last)
+            return { last, too_large };
+        *first++ = '(';
+        for (size_t i = 0; i < data.size(); i++)
         {
-            out << ",";
-            out << data.at(i);
+            if (i != 0)
+            {
+                if (first == last)
+                    return { last, too_large };
+                *first++ = ',';
+            }
+
+            const auto result = std::to_chars(first, last, data[i]);
+            if (result.ec != std::errc {})
+                return result;
+            first = result.ptr;
         }
 
-        out << ")";
-        return out.str();
+        if (first == last)
+            return { last, too_large };
+        *first++ = ')';
+        return { first, std::errc {} };
     }
 
+    /**
+     * @brief Read a text likes "(1,2)" or "( 1, 2 )" with exactly `dimension` values from [first, last), without
+     * allocation and independent of the locale. ASCII whitespace is skipped before the values and the separators, the
+     * returned pointer is just past ')'. Return { first, std::errc::invalid_argument } on a bad text, then `value` is unspecified
+     */
+    static std::from_chars_result from_chars(const char* first, const char* last, coordinate& value) noexcept
+    {
+        const std::from_chars_result invalid { first, std::errc::invalid_argument };
+        first = detail::skip_space(first, last);
+        if (first == last || *first != '(')
+            return invalid;
+        ++first;
+
+        for (size_t i = 0; i < value.data.size(); i++)
+        {
+            const auto result = std::from_chars(detail::skip_space(first, last), last, value.data[i]);
+            if (result.ec != std::errc {})
+                return { invalid.ptr, result.ec };
+            first = detail::skip_space(result.ptr, last);
+
+            const char separator = i + 1 == value.data.size() ? ')' : ',';
+            if (first == last || *first != separator)
+                return invalid;
+            ++first;
+        }
+        return { first, std::errc {} };
+    }
+
+    [[nodiscard]] std::string to_string() const
+    {
+        std::array<char, max_chars> buffer; // NOLINT(cppcoreguidelines-pro-type-member-init)
+        const auto result = to_chars(buffer.data(), buffer.data() + buffer.size());
+        return { buffer.data(), result.ptr };
+    }
+
+    // The whole string must be one coordinate, surrounding whitespace is allowed
     static coordinate<T, dimension> from_string(std::string_view str)
     {
-        std::istringstream in_stream(str.data());
         coordinate<T, dimension> temp {};
-        in_stream >> temp;
+        const char* const last = str.data() + str.size();
+        const auto result = from_chars(str.data(), last, temp);
+        if (result.ec != std::errc {} || detail::skip_space(result.ptr, last) != last)
+            throw std::runtime_error("From string to data fails!");
         return temp;
     }
 
     DataType data; // NOLINT(misc-non-private-member-variables-in-classes)
 };
 
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr auto dot(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+{
+    typename coordinate<T, dimension>::accumulate_type result = 0;
+    detail::unroll<dimension>([&](auto i) { result += static_cast<decltype(result)>(lhs.data[i]) * static_cast<decltype(result)>(rhs.data[i]); });
+    return result;
+}
+
+// The z of the cross product of two points as 3D vectors, positive if `rhs` is counterclockwise from `lhs`
+template <typename T>
+[[nodiscard]] constexpr auto cross(const coordinate<T, 2>& lhs, const coordinate<T, 2>& rhs) noexcept
+{
+    using accumulate_type = typename coordinate<T, 2>::accumulate_type;
+    return static_cast<accumulate_type>(lhs.data[0]) * static_cast<accumulate_type>(rhs.data[1])
+        - static_cast<accumulate_type>(lhs.data[1]) * static_cast<accumulate_type>(rhs.data[0]);
+}
+
+// Computed in accumulate_type like the 2D cross, so the products of integral coordinates don't overflow
+template <typename T>
+[[nodiscard]] constexpr auto cross(const coordinate<T, 3>& lhs, const coordinate<T, 3>& rhs) noexcept
+{
+    using accumulate_type = typename coordinate<T, 3>::accumulate_type;
+    const coordinate<accumulate_type, 3> lhs_value { { static_cast<accumulate_type>(lhs.data[0]), static_cast<accumulate_type>(lhs.data[1]), static_cast<accumulate_type>(lhs.data[2]) } };
+    const coordinate<accumulate_type, 3> rhs_value { { static_cast<accumulate_type>(rhs.data[0]), static_cast<accumulate_type>(rhs.data[1]), static_cast<accumulate_type>(rhs.data[2]) } };
+
+    coordinate<accumulate_type, 3> result {};
+    result.data[0] = lhs_value.data[1] * rhs_value.data[2] - lhs_value.data[2] * rhs_value.data[1];
+    result.data[1] = lhs_value.data[2] * rhs_value.data[0] - lhs_value.data[0] * rhs_value.data[2];
+    result.data[2] = lhs_value.data[0] * rhs_value.data[1] - lhs_value.data[1] * rhs_value.data[0];
+    return result;
+}
+
+// `lhs` when `factor` is 0 and `rhs` when it is 1
+template <typename T, std::size_t dimension>
+    requires(std::is_floating_point_v<T>)
+[[nodiscard]] constexpr coordinate<T, dimension> lerp(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs, T factor) noexcept
+{
+    coordinate<T, dimension> result {};
+    detail::unroll<dimension>([&](auto i) { result.data[i] = lhs.data[i] + factor * (rhs.data[i] - lhs.data[i]); });
+    return result;
+}
+
+// The coordinate scaled to length 1, a zero coordinate stays zero
+template <typename T, std::size_t dimension>
+    requires(std::is_floating_point_v<T>)
+[[nodiscard]] constexpr coordinate<T, dimension> normalize(const coordinate<T, dimension>& value) noexcept
+{
+    const T length = detail::sqrt_value(value.distance_rough());
+    if (length == 0)
+        return value;
+
+    coordinate<T, dimension> result {};
+    detail::unroll<dimension>([&](auto i) { result.data[i] = value.data[i] / length; });
+    return result;
+}
+
+// The smaller value of every axis
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr coordinate<T, dimension> (min)(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+{
+    coordinate<T, dimension> result {};
+    detail::unroll<dimension>([&](auto i) { result.data[i] = (std::min)(lhs.data[i], rhs.data[i]); });
+    return result;
+}
+
+// The larger value of every axis
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr coordinate<T, dimension> (max)(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+{
+    coordinate<T, dimension> result {};
+    detail::unroll<dimension>([&](auto i) { result.data[i] = (std::max)(lhs.data[i], rhs.data[i]); });
+    return result;
+}
+
+// Clamp every axis into [low, high]
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr coordinate<T, dimension> clamp(const coordinate<T, dimension>& value, const coordinate<T, dimension>& low, const coordinate<T, dimension>& high) noexcept
+{
+    coordinate<T, dimension> result {};
+    detail::unroll<dimension>([&](auto i) { result.data[i] = std::clamp(value.data[i], low.data[i], high.data[i]); });
+    return result;
+}
+
+// The sum of the distances along every axis
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr auto manhattan_distance(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+{
+    typename coordinate<T, dimension>::accumulate_type result = 0;
+    detail::unroll<dimension>([&](auto i) {
+        const auto lhs_value = static_cast<decltype(result)>(lhs.data[i]);
+        const auto rhs_value = static_cast<decltype(result)>(rhs.data[i]);
+        result += lhs_value < rhs_value ? rhs_value - lhs_value : lhs_value - rhs_value;
+    });
+    return result;
+}
+
+// The largest distance along one axis
+template <typename T, std::size_t dimension>
+[[nodiscard]] constexpr auto chebyshev_distance(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+{
+    typename coordinate<T, dimension>::accumulate_type result = 0;
+    detail::unroll<dimension>([&](auto i) {
+        const auto lhs_value = static_cast<decltype(result)>(lhs.data[i]);
+        const auto rhs_value = static_cast<decltype(result)>(rhs.data[i]);
+        result = (std::max)(result, lhs_value < rhs_value ? rhs_value - lhs_value : lhs_value - rhs_value);
+    });
+    return result;
+}
+
+/**
+ * @brief Parse every coordinate likes "(1,2)" in a buffer, e.g. a whole file mapped by mapped_file, and append them to
+ * `result` without any other allocation. Coordinates are separated by whitespace, ',' or ';'.
+ * Throw std::runtime_error with the offset of the first bad coordinate, the coordinates before it are kept
+ */
+template <typename T, std::size_t dimension>
+void parse_coordinate_list(std::string_view text, std::vector<coordinate<T, dimension>>& result)
+{
+    result.reserve(result.size() + static_cast<std::size_t>(std::count(text.begin(), text.end(), '(')));
+
+    const char* first = text.data();
+    const char* const last = first + text.size();
+    while (true)
+    {
+        while (first != last && (*first == ' ' || *first == '\t' || *first == '\r' || *first == '\n' || *first == ',' || *first == ';'))
+            ++first;
+        if (first == last)
+            return;
+
+        auto& value = result.emplace_back();
+        const auto parse_result = coordinate<T, dimension>::from_chars(first, last, value);
+        if (parse_result.ec != std::errc {})
+        {
+            result.pop_back();
+            throw std::runtime_error("From string to data fails at offset " + std::to_string(first - text.data()));
+        }
+        first = parse_result.ptr;
+    }
+}
+
 template <typename T>
 using point = coordinate<T, 2>;
 
@@ -0,0 +1,459 @@
+#pragma once
+
+#include "base.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace lot {
+
+class coordinate_codec_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+enum class coordinate_encoding : std::uint8_t
+{
+    fixed = 0,        // Every value in sizeof(T) little-endian bytes, can be viewed without copy (see view_coordinates)
+    delta_varint = 1, // Integral T only, every axis as the zigzag LEB128 varint of its difference to the previous coordinate
+};
+
+/**
+ * @brief Header of a block of coordinates, it is followed by `payload_size` bytes of payload and zero padding up to
+ * a multiple of `block_alignment`, so consecutive blocks and fixed payloads stay aligned. All values are little-endian
+ */
+struct coordinate_block_header
+{
+    static constexpr std::array<char, 4> block_magic = { 'L', 'O', 'T', 'C' };
+    static constexpr std::uint16_t current_version = 1;
+    static constexpr std::size_t block_alignment = 8;
+
+    std::array<char, 4> magic = block_magic;
+    std::uint16_t version = current_version;
+    std::uint8_t encoding = 0;   // coordinate_encoding
+    std::uint8_t value_kind = 0; // See detail::coordinate_value_kind
+    std::uint32_t dimension = 0;
+    std::uint32_t count = 0; // Number of coordinates
+    std::uint32_t payload_size = 0;
+    std::uint32_t reserved = 0;
+};
+
+static_assert(sizeof(coordinate_block_header) == 24 && std::is_trivially_copyable_v<coordinate_block_header>);
+
+namespace detail {
+
+    // sizeof(T) with a bit for signed and a bit for floating types, a block is only decoded into the same T
+    template <typename T>
+    inline constexpr std::uint8_t coordinate_value_kind = static_cast<std::uint8_t>(sizeof(T) | (std::is_signed_v<T> ? 0x40U : 0U) | (std::is_floating_point_v<T> ? 0x80U : 0U));
+
+    constexpr std::size_t align_block_size(std::size_t size) noexcept
+    {
+        return (size + coordinate_block_header::block_alignment - 1) / coordinate_block_header::block_alignment * coordinate_block_header::block_alignment;
+    }
+
+    template <typename U>
+    [[nodiscard]] constexpr U swap_bytes(U value) noexcept
+    {
+        static_assert(std::is_unsigned_v<U>);
+        U result = 0;
+        for (std::size_t index = 0; index < sizeof(U); ++index)
+        {
+            result = static_cast<U>((result << 8U) | (value & 0xFFU));
+            value = static_cast<U>(value >> 8U);
+        }
+        return result;
+    }
+
+    // Convert between native and little-endian byte order, the same operation in both directions
+    template <typename T>
+    [[nodiscard]] constexpr T little_endian(T value) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1)
+        {
+            return value;
+        } else {
+            using bits_type = std::conditional_t<sizeof(T) == 2, std::uint16_t, std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+            return std::bit_cast<T>(swap_bytes(std::bit_cast<bits_type>(value)));
+        }
+    }
+
+    [[nodiscard]] inline coordinate_block_header little_endian(coordinate_block_header header) noexcept
+    {
+        header.version = little_endian(header.version);
+        header.dimension = little_endian(header.dimension);
+        header.count = little_endian(header.count);
+        header.payload_size = little_endian(header.payload_size);
+        return header;
+    }
+
+    inline void append_varint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80U)
+        {
+            out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+            value >>= 7U;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Throw coordinate_codec_error on a truncated varint, one longer than `max_size` bytes or one above 64 bits
+    [[nodiscard]] inline std::uint64_t read_varint(const unsigned char*& ptr, const unsigned char* end, std::size_t max_size)
+    {
+        lo_assert(max_size <= 10);
+        std::uint64_t result = 0;
+        for (unsigned shift = 0; shift < max_size * 7; shift += 7)
+        {
+            if (ptr == end)
+                throw coordinate_codec_error("coordinate block is truncated");
+            const std::uint64_t byte = *ptr++;
+            // The 10th byte only holds bit 63, anything more would be shifted out silently
+            if (shift == 63 && byte > 1)
+                throw coordinate_codec_error("coordinate block has a bad varint");
+            result |= (byte & 0x7FU) << shift;
+            if ((byte & 0x80U) == 0)
+                return result;
+        }
+        throw coordinate_codec_error("coordinate block has a bad varint");
+    }
+
+    // The most bytes one value of T takes in `encoding`: sizeof(T), or a varint of the zigzag delta with 7 bits per byte
+    template <typename T>
+    [[nodiscard]] constexpr std::size_t max_encoded_value_size(coordinate_encoding encoding) noexcept
+    {
+        return encoding == coordinate_encoding::fixed ? sizeof(T) : (sizeof(T) * 8 + 6) / 7;
+    }
+
+    /**
+     * @brief Check a header in native byte order before anything is allocated for its block: the coordinate type, the
+     * encoding and a payload size that `count` values can have in that encoding
+     */
+    template <typename T, std::size_t dimension>
+    void check_block_header(const coordinate_block_header& header)
+    {
+        if (header.magic != coordinate_block_header::block_magic)
+            throw coordinate_codec_error("coordinate block has a bad magic");
+        if (header.version != coordinate_block_header::current_version)
+            throw coordinate_codec_error("coordinate block version " + std::to_string(header.version) + " is not supported");
+        if (header.value_kind != coordinate_value_kind<T> || header.dimension != dimension)
+            throw coordinate_codec_error("coordinate block holds another coordinate type");
+
+        const auto encoding = static_cast<coordinate_encoding>(header.encoding);
+        if (encoding != coordinate_encoding::fixed && !(encoding == coordinate_encoding::delta_varint && std::is_integral_v<T>))
+            throw coordinate_codec_error("coordinate block has a bad encoding");
+
+        // Every value takes at least one byte and at most max_encoded_value_size, exactly sizeof(T) when fixed
+        const std::size_t value_count = std::size_t { header.count } * dimension;
+        const std::size_t min_payload_size = encoding == coordinate_encoding::fixed ? value_count * sizeof(T) : value_count;
+        if (header.payload_size < min_payload_size || header.payload_size > value_count * max_encoded_value_size<T>(encoding))
+            throw coordinate_codec_error("coordinate block has a bad payload size");
+    }
+
+    // Check the header of the block at `data` and return it in native byte order
+    template <typename T, std::size_t dimension>
+    [[nodiscard]] coordinate_block_header read_block_header(const char* data, std::size_t size)
+    {
+        if (size < sizeof(coordinate_block_header))
+            throw coordinate_codec_error("coordinate block is truncated");
+
+        coordinate_block_header header;
+        std::memcpy(&header, data, sizeof(header));
+        header = little_endian(header);
+        check_block_header<T, dimension>(header);
+        if (size - sizeof(header) < header.payload_size)
+            throw coordinate_codec_error("coordinate block is truncated");
+        return header;
+    }
+
+} // namespace detail
+
+/**
+ * @brief Append one block with `coordinate_list` to `out`
+ *
+ * @return The size of the block
+ */
+template <typename T, std::size_t dimension>
+std::size_t encode_coordinates(std::span<const coordinate<T, dimension>> coordinate_list, coordinate_encoding encoding, std::string& out)
+{
+    if (encoding == coordinate_encoding::delta_varint && !std::is_integral_v<T>)
+        throw coordinate_codec_error("delta_varint encoding requires integral coordinates");
+    // Both the count and the worst-case payload must fit the 32-bit header fields
+    constexpr auto max_field = (std::numeric_limits<std::uint32_t>::max)();
+    if (coordinate_list.size() > max_field
+        || (dimension != 0 && coordinate_list.size() > max_field / (dimension * detail::max_encoded_value_size<T>(encoding))))
+        throw coordinate_codec_error("too many coordinates for one block");
+
+    const std::size_t block_begin = out.size();
+    out.resize(block_begin + sizeof(coordinate_block_header));
+
+    if (encoding == coordinate_encoding::fixed)
+    {
+        const std::size_t payload_begin = out.size();
+        out.resize(payload_begin + coordinate_list.size() * dimension * sizeof(T));
+        if constexpr (std::endian::native == std::endian::little && sizeof(coordinate<T, dimension>) == dimension * sizeof(T))
+        {
+            if (!coordinate_list.empty())
+                std::memcpy(out.data() + payload_begin, coordinate_list.data(), coordinate_list.size_bytes());
+        } else {
+            char* ptr = out.data() + payload_begin;
+            for (const auto& value : coordinate_list)
+            {
+                for (auto axis_value : value.data)
+                {
+                    axis_value = detail::little_endian(axis_value);
+                    std::memcpy(ptr, &axis_value, sizeof(T));
+                    ptr += sizeof(T);
+                }
+            }
+        }
+    } else if constexpr (std::is_integral_v<T>) {
+        using unsigned_type = std::make_unsigned_t<T>;
+        using signed_type = std::make_signed_t<T>;
+        out.reserve(out.size() + coordinate_list.size() * dimension * 2);
+        std::array<unsigned_type, dimension> previous {};
+        for (const auto& value : coordinate_list)
+        {
+            for (std::size_t axis = 0; axis < dimension; ++axis)
+            {
+                // The difference wraps around like the unsigned type, read back as signed it is small for close values
+                const auto current = static_cast<unsigned_type>(value.data[axis]);
+                const auto delta = static_cast<std::int64_t>(static_cast<signed_type>(static_cast<unsigned_type>(current - previous[axis])));
+                detail::append_varint(out, (static_cast<std::uint64_t>(delta) << 1U) ^ static_cast<std::uint64_t>(delta >> 63));
+                previous[axis] = current;
+            }
+        }
+    }
+
+    coordinate_block_header header;
+    header.encoding = static_cast<std::uint8_t>(encoding);
+    header.value_kind = detail::coordinate_value_kind<T>;
+    header.dimension = static_cast<std::uint32_t>(dimension);
+    header.count = static_cast<std::uint32_t>(coordinate_list.size());
+    header.payload_size = static_cast<std::uint32_t>(out.size() - block_begin - sizeof(header));
+    header = detail::little_endian(header);
+    std::memcpy(out.data() + block_begin, &header, sizeof(header));
+
+    out.resize(block_begin + detail::align_block_size(out.size() - block_begin));
+    return out.size() - block_begin;
+}
+
+/**
+ * @brief Decode the block at `data` and append its coordinates to `result`. Throw coordinate_codec_error if the
+ * block is damaged or holds another coordinate type, then `result` is left as it was
+ *
+ * @return The size of the block, the next block starts there
+ */
+template <typename T, std::size_t dimension>
+std::size_t decode_coordinates(const char* data, std::size_t size, std::vector<coordinate<T, dimension>>& result)
+{
+    const auto header = detail::read_block_header<T, dimension>(data, size);
+    const auto* payload = reinterpret_cast<const unsigned char*>(data + sizeof(header)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* payload_end = payload + header.payload_size;
+
+    const std::size_t result_begin = result.size();
+    if (header.encoding == static_cast<std::uint8_t>(coordinate_encoding::fixed))
+    {
+        result.resize(result_begin + header.count);
+        for (std::size_t index = 0; index < header.count; ++index)
+        {
+            for (auto& axis_value : result[result_begin + index].data)
+            {
+                std::memcpy(&axis_value, payload, sizeof(T));
+                axis_value = detail::little_endian(axis_value);
+                payload += sizeof(T);
+            }
+        }
+    } else if (header.encoding == static_cast<std::uint8_t>(coordinate_encoding::delta_varint)) {
+        if constexpr (std::is_integral_v<T>)
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            constexpr std::size_t max_varint_size = detail::max_encoded_value_size<T>(coordinate_encoding::delta_varint);
+            // The header check bounds the count by the payload size, so this can't be made to allocate much more than the block
+            result.resize(result_begin + header.count);
+            try {
+                std::array<unsigned_type, dimension> previous {};
+                for (std::size_t index = 0; index < header.count; ++index)
+                {
+                    for (std::size_t axis = 0; axis < dimension; ++axis)
+                    {
+                        const auto zigzag = detail::read_varint(payload, payload_end, max_varint_size);
+                        // The encoder never writes a zigzag delta wider than T
+                        if constexpr (sizeof(T) < sizeof(std::uint64_t))
+                            if (zigzag > (std::numeric_limits<unsigned_type>::max)())
+                                throw coordinate_codec_error("coordinate block has a bad varint");
+                        const auto delta = static_cast<std::uint64_t>((zigzag >> 1U) ^ (~(zigzag & 1U) + 1U));
+                        previous[axis] = static_cast<unsigned_type>(previous[axis] + static_cast<unsigned_type>(delta));
+                        result[result_begin + index].data[axis] = static_cast<T>(previous[axis]);
+                    }
+                }
+                if (payload != payload_end)
+                    throw coordinate_codec_error("coordinate block has trailing payload bytes");
+            } catch (...) {
+                result.resize(result_begin);
+                throw;
+            }
+        }
+    }
+
+    return (std::min)(size, detail::align_block_size(sizeof(header) + header.payload_size));
+}
+
+/**
+ * @brief View the coordinates of the block at `data` in place, without copy. Only possible for the fixed encoding on a
+ * little-endian machine with `data` aligned for T, otherwise return std::nullopt and the block must be decoded.
+ * Throw coordinate_codec_error if the block is damaged or holds another coordinate type
+ *
+ * @param block_size Receives the size of the block
+ */
+template <typename T, std::size_t dimension>
+[[nodiscard]] std::optional<std::span<const coordinate<T, dimension>>> view_coordinates(const char* data, std::size_t size, std::size_t* block_size = nullptr)
+{
+    const auto header = detail::read_block_header<T, dimension>(data, size);
+    if (block_size != nullptr)
+        *block_size = (std::min)(size, detail::align_block_size(sizeof(header) + header.payload_size));
+
+    if constexpr (std::endian::native != std::endian::little || sizeof(coordinate<T, dimension>) != dimension * sizeof(T))
+    {
+        return std::nullopt;
+    } else {
+        const char* payload = data + sizeof(header);
+        if (header.encoding != static_cast<std::uint8_t>(coordinate_encoding::fixed) || reinterpret_cast<std::uintptr_t>(payload) % alignof(coordinate<T, dimension>) != 0) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            return std::nullopt;
+        return std::span(reinterpret_cast<const coordinate<T, dimension>*>(payload), header.count); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+}
+
+/**
+ * @brief Write coordinates to a stream in blocks of up to `block_count` coordinates, so a stream larger than memory
+ * is written with one block of memory. Call `flush` to write the last block, the destructor only tries to
+ */
+template <typename T, std::size_t dimension>
+class coordinate_writer
+{
+public:
+    explicit coordinate_writer(std::ostream& out, coordinate_encoding encoding = coordinate_encoding::fixed, std::size_t block_count = 65536)
+        : out_(out), encoding_(encoding), block_count_(block_count)
+    {
+        lo_assert(block_count > 0);
+        pending_list_.reserve(block_count);
+    }
+
+    coordinate_writer(const coordinate_writer&) = delete;
+    coordinate_writer& operator=(const coordinate_writer&) = delete;
+
+    ~coordinate_writer()
+    {
+        try {
+            flush();
+        } catch (...) { // NOLINT(bugprone-empty-catch)
+        }
+    }
+
+    coordinate_writer& write(const coordinate<T, dimension>& value)
+    {
+        pending_list_.push_back(value);
+        if (pending_list_.size() == block_count_)
+            write_block();
+        return *this;
+    }
+
+    coordinate_writer& write(std::span<const coordinate<T, dimension>> coordinate_list)
+    {
+        for (const auto& value : coordinate_list)
+            write(value);
+        return *this;
+    }
+
+    // Write the pending coordinates as a block, throw coordinate_codec_error if the stream fails
+    void flush()
+    {
+        if (!pending_list_.empty())
+            write_block();
+        out_.flush();
+        if (!out_)
+            throw coordinate_codec_error("coordinate_writer write fails");
+    }
+
+private:
+    void write_block()
+    {
+        buffer_.clear();
+        encode_coordinates<T, dimension>(pending_list_, encoding_, buffer_);
+        pending_list_.clear();
+        if (!out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size())))
+            throw coordinate_codec_error("coordinate_writer write fails");
+    }
+
+    std::ostream& out_;
+    coordinate_encoding encoding_;
+    std::size_t block_count_;
+    std::vector<coordinate<T, dimension>> pending_list_;
+    std::string buffer_;
+};
+
+// Read the blocks written by coordinate_writer one at a time
+template <typename T, std::size_t dimension>
+class coordinate_reader
+{
+public:
+    explicit coordinate_reader(std::istream& in) : in_(in)
+    {
+    }
+
+    /**
+     * @brief Read the next block into `result`, which is cleared first. Return false at the end of the stream,
+     * throw coordinate_codec_error if a block is damaged or truncated
+     */
+    bool read(std::vector<coordinate<T, dimension>>& result)
+    {
+        result.clear();
+
+        buffer_.resize(sizeof(coordinate_block_header));
+        in_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        if (in_.gcount() == 0)
+            return false;
+        if (static_cast<std::size_t>(in_.gcount()) != buffer_.size())
+            throw coordinate_codec_error("coordinate block is truncated");
+
+        coordinate_block_header header;
+        std::memcpy(&header, buffer_.data(), sizeof(header));
+        header = detail::little_endian(header);
+        detail::check_block_header<T, dimension>(header);
+
+        // The payload size is still untrusted, grow the buffer at most by doubling so a truncated stream can't make it
+        // allocate much more than it holds
+        const std::size_t block_size = detail::align_block_size(sizeof(header) + header.payload_size);
+        std::size_t read_size = sizeof(header);
+        while (read_size < block_size)
+        {
+            const std::size_t chunk_size = (std::min)(block_size - read_size, (std::max)(read_size, std::size_t { 65536 }));
+            buffer_.resize(read_size + chunk_size);
+            in_.read(buffer_.data() + read_size, static_cast<std::streamsize>(chunk_size));
+            read_size += static_cast<std::size_t>(in_.gcount());
+            if (static_cast<std::size_t>(in_.gcount()) != chunk_size)
+                break;
+        }
+
+        decode_coordinates<T, dimension>(buffer_.data(), read_size, result);
+        return true;
+    }
+
+private:
+    std::istream& in_;
+    std::string buffer_;
+};
+
+} // namespace lot
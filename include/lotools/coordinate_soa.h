@@ -0,0 +1,428 @@
+#pragma once
+
+#include "base.h"
+#include "coordinate.h"
+#include "simd.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace lot {
+
+namespace detail {
+
+    // Allocate with the given alignment, so SIMD loads of the first elements never split a cache line
+    template <typename T, std::size_t alignment>
+    struct aligned_allocator
+    {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = aligned_allocator<U, alignment>;
+        };
+
+        aligned_allocator() = default;
+
+        template <typename U>
+        aligned_allocator(const aligned_allocator<U, alignment>& /*other*/) noexcept // NOLINT(google-explicit-constructor)
+        {
+        }
+
+        [[nodiscard]] T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t { alignment }));
+        }
+
+        void deallocate(T* ptr, std::size_t count) noexcept
+        {
+            ::operator delete(ptr, count * sizeof(T), std::align_val_t { alignment });
+        }
+
+        friend bool operator==(const aligned_allocator& /*lhs*/, const aligned_allocator& /*rhs*/) noexcept
+        {
+            return true;
+        }
+    };
+
+    // The batch kernels below vectorize float, other types use the scalar loop that ends every kernel
+
+    // data[i] += value
+    template <typename T>
+    void add_scalar_span(T* data, std::size_t count, T value) noexcept
+    {
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            const auto value_8 = _mm256_set1_ps(value);
+            for (; index + 8 <= count; index += 8)
+                _mm256_storeu_ps(data + index, _mm256_add_ps(_mm256_loadu_ps(data + index), value_8));
+#endif
+#if defined(LOT_SIMD_SSE2)
+            const auto value_4 = _mm_set1_ps(value);
+            for (; index + 4 <= count; index += 4)
+                _mm_storeu_ps(data + index, _mm_add_ps(_mm_loadu_ps(data + index), value_4));
+#endif
+        }
+        for (; index < count; ++index)
+            data[index] += value;
+    }
+
+    // data[i] *= factor
+    template <typename T>
+    void scale_span(T* data, std::size_t count, T factor) noexcept
+    {
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            const auto factor_8 = _mm256_set1_ps(factor);
+            for (; index + 8 <= count; index += 8)
+                _mm256_storeu_ps(data + index, _mm256_mul_ps(_mm256_loadu_ps(data + index), factor_8));
+#endif
+#if defined(LOT_SIMD_SSE2)
+            const auto factor_4 = _mm_set1_ps(factor);
+            for (; index + 4 <= count; index += 4)
+                _mm_storeu_ps(data + index, _mm_mul_ps(_mm_loadu_ps(data + index), factor_4));
+#endif
+        }
+        for (; index < count; ++index)
+            data[index] *= factor;
+    }
+
+    // dst[i] += src[i], or dst[i] -= src[i] when `is_add` is false
+    template <bool is_add, typename T>
+    void add_span(T* dst, const T* src, std::size_t count) noexcept
+    {
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            for (; index + 8 <= count; index += 8)
+            {
+                const auto lhs = _mm256_loadu_ps(dst + index);
+                const auto rhs = _mm256_loadu_ps(src + index);
+                _mm256_storeu_ps(dst + index, is_add ? _mm256_add_ps(lhs, rhs) : _mm256_sub_ps(lhs, rhs));
+            }
+#endif
+#if defined(LOT_SIMD_SSE2)
+            for (; index + 4 <= count; index += 4)
+            {
+                const auto lhs = _mm_loadu_ps(dst + index);
+                const auto rhs = _mm_loadu_ps(src + index);
+                _mm_storeu_ps(dst + index, is_add ? _mm_add_ps(lhs, rhs) : _mm_sub_ps(lhs, rhs));
+            }
+#endif
+        }
+        for (; index < count; ++index)
+        {
+            if constexpr (is_add)
+                dst[index] += src[index];
+            else
+                dst[index] -= src[index];
+        }
+    }
+
+    // result[i] = (axis[i] - target)^2, or result[i] += (axis[i] - target)^2 when `is_first` is false
+    template <typename D, typename T>
+    void accumulate_square_diff(D* result, const T* axis, std::size_t count, T target, bool is_first) noexcept
+    {
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float> && std::is_same_v<D, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            const auto target_8 = _mm256_set1_ps(target);
+            for (; index + 8 <= count; index += 8)
+            {
+                const auto diff = _mm256_sub_ps(_mm256_loadu_ps(axis + index), target_8);
+                const auto square = _mm256_mul_ps(diff, diff);
+                _mm256_storeu_ps(result + index, is_first ? square : _mm256_add_ps(_mm256_loadu_ps(result + index), square));
+            }
+#endif
+#if defined(LOT_SIMD_SSE2)
+            const auto target_4 = _mm_set1_ps(target);
+            for (; index + 4 <= count; index += 4)
+            {
+                const auto diff = _mm_sub_ps(_mm_loadu_ps(axis + index), target_4);
+                const auto square = _mm_mul_ps(diff, diff);
+                _mm_storeu_ps(result + index, is_first ? square : _mm_add_ps(_mm_loadu_ps(result + index), square));
+            }
+#endif
+        }
+        for (; index < count; ++index)
+        {
+            const D diff = static_cast<D>(axis[index]) - static_cast<D>(target);
+            result[index] = is_first ? diff * diff : result[index] + diff * diff;
+        }
+    }
+
+    template <typename T>
+    void sqrt_span(T* data, std::size_t count) noexcept
+    {
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            for (; index + 8 <= count; index += 8)
+                _mm256_storeu_ps(data + index, _mm256_sqrt_ps(_mm256_loadu_ps(data + index)));
+#endif
+#if defined(LOT_SIMD_SSE2)
+            for (; index + 4 <= count; index += 4)
+                _mm_storeu_ps(data + index, _mm_sqrt_ps(_mm_loadu_ps(data + index)));
+#endif
+        }
+        for (; index < count; ++index)
+            data[index] = std::sqrt(data[index]);
+    }
+
+    // Return the index of the first smallest element, `count` if it is empty. NaN are ignored
+    template <typename T>
+    [[nodiscard]] std::size_t find_min(const T* data, std::size_t count) noexcept
+    {
+        T best = std::numeric_limits<T>::infinity();
+        std::size_t index = 0;
+        if constexpr (std::is_same_v<T, float>)
+        {
+#if defined(LOT_SIMD_AVX2)
+            if (count >= 8)
+            {
+                auto best_8 = _mm256_set1_ps(best);
+                for (; index + 8 <= count; index += 8)
+                    best_8 = _mm256_min_ps(_mm256_loadu_ps(data + index), best_8);
+                alignas(32) std::array<float, 8> lane_list {};
+                _mm256_store_ps(lane_list.data(), best_8);
+                best = *std::min_element(lane_list.begin(), lane_list.end());
+            }
+#endif
+#if defined(LOT_SIMD_SSE2)
+            if (count - index >= 4)
+            {
+                auto best_4 = _mm_set1_ps(best);
+                for (; index + 4 <= count; index += 4)
+                    best_4 = _mm_min_ps(_mm_loadu_ps(data + index), best_4);
+                alignas(16) std::array<float, 4> lane_list {};
+                _mm_store_ps(lane_list.data(), best_4);
+                best = (std::min)(best, *std::min_element(lane_list.begin(), lane_list.end()));
+            }
+#endif
+        }
+        for (; index < count; ++index)
+            if (data[index] < best)
+                best = data[index];
+
+        // The vector pass only finds the value, the first element equal to it is the answer
+        for (index = 0; index < count; ++index)
+            if (data[index] == best)
+                return index;
+        return count;
+    }
+
+} // namespace detail
+
+/**
+ * @brief Coordinates stored as structure of arrays: every axis is its own contiguous, 32-byte aligned array,
+ * so batch operations run over all points with SIMD (AVX2 or SSE2 for float, selected at compile time, see simd.h)
+ * instead of one small std::array at a time. Other arithmetic types use scalar loops
+ *
+ * @tparam T Data type of coordinate
+ * @tparam dimension The number of dimensions
+ */
+template <typename T, std::size_t dimension>
+class coordinate_soa
+{
+public:
+    static_assert(std::is_arithmetic_v<T>, "T must be an arithmetic type!");
+
+    static constexpr std::size_t alignment = 32;
+
+    using value_type = coordinate<T, dimension>;
+    using axis_type = std::vector<T, detail::aligned_allocator<T, alignment>>;
+    // Distances of integer coordinates are computed in double
+    using distance_type = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+    coordinate_soa() = default;
+
+    explicit coordinate_soa(std::span<const value_type> coordinate_list)
+    {
+        assign(coordinate_list);
+    }
+
+    void assign(std::span<const value_type> coordinate_list)
+    {
+        resize(coordinate_list.size());
+        for (std::size_t index = 0; index < coordinate_list.size(); ++index)
+            set(index, coordinate_list[index]);
+    }
+
+    [[nodiscard]] std::vector<value_type> to_vector() const
+    {
+        std::vector<value_type> result(size());
+        for (std::size_t index = 0; index < result.size(); ++index)
+            result[index] = get(index);
+        return result;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return axis_list_[0].size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return axis_list_[0].empty();
+    }
+
+    void reserve(std::size_t count)
+    {
+        for (auto& axis : axis_list_)
+            axis.reserve(count);
+    }
+
+    // New coordinates are zero
+    void resize(std::size_t count)
+    {
+        for (auto& axis : axis_list_)
+            axis.resize(count);
+    }
+
+    void clear() noexcept
+    {
+        for (auto& axis : axis_list_)
+            axis.clear();
+    }
+
+    void push_back(const value_type& value)
+    {
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            axis_list_[axis_index].push_back(value.data[axis_index]);
+    }
+
+    [[nodiscard]] value_type get(std::size_t index) const noexcept
+    {
+        lo_assert(index < size());
+        value_type result {};
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            result.data[axis_index] = axis_list_[axis_index][index];
+        return result;
+    }
+
+    void set(std::size_t index, const value_type& value) noexcept
+    {
+        lo_assert(index < size());
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            axis_list_[axis_index][index] = value.data[axis_index];
+    }
+
+    // The values of one axis, e.g. axis(0) is every x
+    [[nodiscard]] std::span<T> axis(std::size_t axis_index) noexcept
+    {
+        lo_assert(axis_index < dimension);
+        return axis_list_[axis_index];
+    }
+
+    [[nodiscard]] std::span<const T> axis(std::size_t axis_index) const noexcept
+    {
+        lo_assert(axis_index < dimension);
+        return axis_list_[axis_index];
+    }
+
+    // Move every coordinate by `offset`
+    coordinate_soa& add(const value_type& offset) noexcept
+    {
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            detail::add_scalar_span(axis_list_[axis_index].data(), size(), offset.data[axis_index]);
+        return *this;
+    }
+
+    coordinate_soa& sub(const value_type& offset) noexcept
+    {
+        return add(-offset);
+    }
+
+    coordinate_soa& scale(T factor) noexcept
+    {
+        for (auto& axis : axis_list_)
+            detail::scale_span(axis.data(), axis.size(), factor);
+        return *this;
+    }
+
+    // Add the coordinates of `other` one by one, both have the same size
+    coordinate_soa& add(const coordinate_soa& other) noexcept
+    {
+        lo_assert(other.size() == size());
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            detail::add_span<true>(axis_list_[axis_index].data(), other.axis_list_[axis_index].data(), size());
+        return *this;
+    }
+
+    coordinate_soa& sub(const coordinate_soa& other) noexcept
+    {
+        lo_assert(other.size() == size());
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            detail::add_span<false>(axis_list_[axis_index].data(), other.axis_list_[axis_index].data(), size());
+        return *this;
+    }
+
+    // Write the squared distance between every coordinate and `target` to `result`, which holds at least size() values
+    void distance_squared(const value_type& target, std::span<distance_type> result) const noexcept
+    {
+        lo_assert(result.size() >= size());
+        for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+            detail::accumulate_square_diff(result.data(), axis_list_[axis_index].data(), size(), target.data[axis_index], axis_index == 0);
+    }
+
+    void distance(const value_type& target, std::span<distance_type> result) const noexcept
+    {
+        distance_squared(target, result);
+        detail::sqrt_span(result.data(), size());
+    }
+
+    /**
+     * @brief Return the index of the first coordinate nearest to `target`, size() if it is empty. A NaN distance is
+     * skipped like in find_min, so size() is also returned when every distance is NaN. Infinite distances count,
+     * the first one is returned if no distance is finite
+     */
+    [[nodiscard]] std::size_t nearest(const value_type& target) const noexcept
+    {
+        // Work in blocks that stay in L1 instead of writing every distance out
+        constexpr std::size_t block_size = 512;
+        std::array<distance_type, block_size> block {};
+
+        std::size_t result = size();
+        distance_type best = std::numeric_limits<distance_type>::infinity();
+        for (std::size_t block_begin = 0; block_begin < size(); block_begin += block_size)
+        {
+            const std::size_t count = (std::min)(block_size, size() - block_begin);
+            for (std::size_t axis_index = 0; axis_index < dimension; ++axis_index)
+                detail::accumulate_square_diff(block.data(), axis_list_[axis_index].data() + block_begin, count, target.data[axis_index], axis_index == 0);
+
+            const std::size_t index = detail::find_min(block.data(), count);
+            // The first block seeds `best`, so an infinite distance is still found
+            if (index != count && (result == size() || block[index] < best))
+            {
+                best = block[index];
+                result = block_begin + index;
+            }
+        }
+        return result;
+    }
+
+private:
+    std::array<axis_type, dimension> axis_list_;
+};
+
+template <typename T>
+using point_soa = coordinate_soa<T, 2>;
+
+template <typename T>
+using tripoint_soa = coordinate_soa<T, 3>;
+
+} // namespace lot
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "base.h"
+#include "screen_kernels.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace lot {
+
+/**
+ * @brief A runtime sized character screen with the same mutator API as ascii_screen, stored in one
+ * contiguous row-major buffer. Use it to follow terminal resizes, ascii_screen stays the fast path
+ * when the size is known at compile time
+ */
+class dynamic_ascii_screen
+{
+public:
+    static constexpr char empty_char = ' ';
+
+    dynamic_ascii_screen(std::uint32_t width, std::uint32_t height)
+        : screen_char_ptr_(std::make_unique<char[]>(std::size_t(width) * height)), capacity_(std::size_t(width) * height), width_(width), height_(height)
+    {
+        clear();
+    }
+
+    [[nodiscard]] char* data() noexcept
+    {
+        return screen_char_ptr_.get();
+    }
+
+    [[nodiscard]] const char* data() const noexcept
+    {
+        return screen_char_ptr_.get();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return std::size_t(width_) * height_;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    [[nodiscard]] std::uint32_t width() const noexcept
+    {
+        return width_;
+    }
+
+    [[nodiscard]] std::uint32_t height() const noexcept
+    {
+        return height_;
+    }
+
+    [[nodiscard]] char* row_data(std::uint32_t row) noexcept
+    {
+        lo_assert(row < height_);
+        return data() + std::size_t(row) * width_;
+    }
+
+    [[nodiscard]] const char* row_data(std::uint32_t row) const noexcept
+    {
+        lo_assert(row < height_);
+        return data() + std::size_t(row) * width_;
+    }
+
+    // Make sure `new_capacity` cells can be used without reallocation
+    dynamic_ascii_screen& reserve(std::size_t new_capacity)
+    {
+        if (new_capacity > capacity_)
+            reallocate(new_capacity);
+        return *this;
+    }
+
+    dynamic_ascii_screen& shrink_to_fit()
+    {
+        if (size() < capacity_)
+            reallocate(size());
+        return *this;
+    }
+
+    /**
+     * @brief Change the size of the screen, the content of the overlapping area is kept and new cells are empty.
+     * Reuses the buffer when the capacity is enough (never reallocates on shrink) and moves the rows in place
+     */
+    dynamic_ascii_screen& resize(std::uint32_t new_width, std::uint32_t new_height)
+    {
+        const std::size_t new_size = std::size_t(new_width) * new_height;
+        if (new_size > capacity_)
+        {
+            auto new_screen_ptr = std::make_unique<char[]>(new_size);
+            copy_rows(screen_char_ptr_.get(), width_, height_, new_screen_ptr.get(), new_width, new_height);
+            screen_char_ptr_ = std::move(new_screen_ptr);
+            capacity_ = new_size;
+        } else {
+            move_rows(new_width, new_height);
+        }
+
+        width_ = new_width;
+        height_ = new_height;
+        return *this;
+    }
+
+    dynamic_ascii_screen& clear()
+    {
+        return set(empty_char);
+    }
+
+    dynamic_ascii_screen& clear(std::uint32_t pos_x, std::uint32_t pos_y)
+    {
+        return set(pos_x, pos_y, empty_char);
+    }
+
+    dynamic_ascii_screen& clear_row(std::uint32_t row, std::uint32_t start = 0)
+    {
+        return set_row(row, empty_char, start, width_);
+    }
+
+    dynamic_ascii_screen& clear_row(std::uint32_t row, std::uint32_t start, std::uint32_t end)
+    {
+        return set_row(row, empty_char, start, end);
+    }
+
+    dynamic_ascii_screen& clear_columu(std::uint32_t columu, std::uint32_t start = 0)
+    {
+        return set_columu(columu, empty_char, start, height_);
+    }
+
+    dynamic_ascii_screen& clear_columu(std::uint32_t columu, std::uint32_t start, std::uint32_t end)
+    {
+        return set_columu(columu, empty_char, start, end);
+    }
+
+    dynamic_ascii_screen& set(std::uint32_t pos_x, std::uint32_t pos_y, char new_character)
+    {
+        lo_assert(pos_x < width_ && pos_y < height_);
+        row_data(pos_y)[pos_x] = new_character;
+        return *this;
+    }
+
+    dynamic_ascii_screen& set(char new_character)
+    {
+        std::memset(data(), new_character, size());
+        return *this;
+    }
+
+    dynamic_ascii_screen& set_row(std::uint32_t row, char new_character, std::uint32_t start = 0)
+    {
+        return set_row(row, new_character, start, width_);
+    }
+
+    dynamic_ascii_screen& set_row(std::uint32_t row, char new_character, std::uint32_t start, std::uint32_t end) // NOLINT(bugprone-easily-swappable-parameters)
+    {
+        lo_assert(row < height_);
+        lo_assert(start <= end && end <= width_);
+        std::memset(row_data(row) + start, new_character, end - start);
+        return *this;
+    }
+
+    dynamic_ascii_screen& set_columu(std::uint32_t columu, char new_character, std::uint32_t start = 0)
+    {
+        return set_columu(columu, new_character, start, height_);
+    }
+
+    dynamic_ascii_screen& set_columu(std::uint32_t columu, char new_character, std::uint32_t start, std::uint32_t end) // NOLINT(bugprone-easily-swappable-parameters)
+    {
+        lo_assert(columu < width_);
+        lo_assert(start <= end && end <= height_);
+        auto* columu_ptr = data() + std::size_t(start) * width_ + columu;
+        for (std::uint32_t index = start; index < end; ++index) {
+            *columu_ptr = new_character;
+            columu_ptr += width_;
+        }
+        return *this;
+    }
+
+    [[nodiscard]] char get(std::uint32_t pos_x, std::uint32_t pos_y) const
+    {
+        lo_assert(pos_x < width_ && pos_y < height_);
+        return row_data(pos_y)[pos_x];
+    }
+
+    dynamic_ascii_screen& show(std::ostream& out)
+    {
+        for (std::uint32_t row = 0; row < height_; ++row) {
+            out.write(row_data(row), width_);
+            out << "\n";
+        }
+        return *this;
+    }
+
+    // Write the frame to a file descriptor, usually in one `writev` syscall without going through std::ostream
+    dynamic_ascii_screen& show(int file_descriptor)
+    {
+        detail::write_frame(file_descriptor, data(), width_, width_, height_);
+        return *this;
+    }
+
+    // Build the whole frame (rows separated by '\n') into a reusable buffer
+    dynamic_ascii_screen& show(std::string& frame_buffer)
+    {
+        detail::append_frame(frame_buffer, data(), width_, width_, height_);
+        return *this;
+    }
+
+private:
+    void reallocate(std::size_t new_capacity)
+    {
+        auto new_screen_ptr = std::make_unique<char[]>(new_capacity);
+        std::memcpy(new_screen_ptr.get(), screen_char_ptr_.get(), size());
+        screen_char_ptr_ = std::move(new_screen_ptr);
+        capacity_ = new_capacity;
+    }
+
+    // Copy the overlapping area into another buffer and fill the rest with empty_char
+    static void copy_rows(const char* src, std::uint32_t src_width, std::uint32_t src_height, char* dst, std::uint32_t dst_width, std::uint32_t dst_height)
+    {
+        const std::uint32_t copy_width = (std::min)(src_width, dst_width);
+        const std::uint32_t copy_height = (std::min)(src_height, dst_height);
+        for (std::uint32_t row = 0; row < copy_height; ++row)
+        {
+            char* dst_row = dst + std::size_t(row) * dst_width;
+            std::memcpy(dst_row, src + std::size_t(row) * src_width, copy_width);
+            std::memset(dst_row + copy_width, empty_char, dst_width - copy_width);
+        }
+        std::memset(dst + std::size_t(copy_height) * dst_width, empty_char, std::size_t(dst_height - copy_height) * dst_width);
+    }
+
+    // Change the row stride inside the current buffer, rows are moved forward when the
+    // stride shrinks and backward when it grows so no row overwrites one that is not moved yet
+    void move_rows(std::uint32_t new_width, std::uint32_t new_height)
+    {
+        char* buffer = data();
+        const std::uint32_t copy_width = (std::min)(width_, new_width);
+        const std::uint32_t copy_height = (std::min)(height_, new_height);
+
+        if (new_width < width_)
+        {
+            for (std::uint32_t row = 1; row < copy_height; ++row)
+                std::memmove(buffer + std::size_t(row) * new_width, buffer + std::size_t(row) * width_, copy_width);
+        } else if (new_width > width_) {
+            for (std::uint32_t row = copy_height; row-- > 0;)
+            {
+                char* dst_row = buffer + std::size_t(row) * new_width;
+                std::memmove(dst_row, buffer + std::size_t(row) * width_, copy_width);
+                std::memset(dst_row + copy_width, empty_char, new_width - copy_width);
+            }
+        }
+
+        std::memset(buffer + std::size_t(copy_height) * new_width, empty_char, std::size_t(new_height - copy_height) * new_width);
+    }
+
+    std::unique_ptr<char[]> screen_char_ptr_;
+    std::size_t capacity_;
+    std::uint32_t width_;
+    std::uint32_t height_;
+};
+
+} // namespace lot
\ No newline at end of file
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "base.h"
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// Windows.h is included as is, lotools headers call (std::min) and (std::max) so its min/max macros don't break them
+#ifdef _WIN32
+#    include <Windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace lot {
+
+/**
+ * @brief A file mapped into memory, move only. The mapping stays valid until the object is destroyed or closed,
+ * so pointers into `data()` survive moves of the object. An empty file is not mapped and `data()` is nullptr
+ */
+class mapped_file
+{
+public:
+    enum class access_mode
+    {
+        read_only,
+        read_write,
+    };
+
+    mapped_file() = default;
+
+    // Map an existing file
+    explicit mapped_file(const std::filesystem::path& path, access_mode mode = access_mode::read_only)
+    {
+        open(path, mode, 0, false);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)), mode_(other.mode_)
+    {
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            mode_ = other.mode_;
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        close();
+    }
+
+    // Create (or truncate) the file with `size` bytes and map it for writing
+    [[nodiscard]] static mapped_file create(const std::filesystem::path& path, std::size_t size)
+    {
+        mapped_file file;
+        file.open(path, access_mode::read_write, size, true);
+        return file;
+    }
+
+    // Only writable for read_write mappings
+    [[nodiscard]] char* data() noexcept
+    {
+        return static_cast<char*>(data_);
+    }
+
+    [[nodiscard]] const char* data() const noexcept
+    {
+        return static_cast<const char*>(data_);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] access_mode get_access_mode() const noexcept
+    {
+        return mode_;
+    }
+
+    [[nodiscard]] bool is_open() const noexcept
+    {
+        return data_ != nullptr;
+    }
+
+    // Write the modified pages back to the file, only meaningful for read_write mappings
+    void flush()
+    {
+        if (data_ == nullptr)
+            return;
+#ifdef _WIN32
+        if (::FlushViewOfFile(data_, 0) == 0)
+            throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), "mapped_file flush fails");
+#else
+        if (::msync(data_, size_, MS_SYNC) != 0)
+            throw std::system_error(errno, std::generic_category(), "mapped_file flush fails");
+#endif
+    }
+
+    void close() noexcept
+    {
+        if (data_ == nullptr)
+            return;
+#ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+#else
+        ::munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    void open(const std::filesystem::path& path, access_mode mode, std::size_t size, bool is_create)
+    {
+        mode_ = mode;
+        const bool is_write = mode == access_mode::read_write;
+#ifdef _WIN32
+        auto throw_error = [&](const char* what) {
+            throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), std::string(what) + " : " + path.string());
+        };
+
+        HANDLE file_handle = ::CreateFileW(path.c_str(), is_write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+            is_create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE)
+            throw_error("mapped_file open fails");
+
+        LARGE_INTEGER file_size {};
+        if (is_create)
+            file_size.QuadPart = static_cast<LONGLONG>(size);
+        else if (::GetFileSizeEx(file_handle, &file_size) == 0)
+        {
+            ::CloseHandle(file_handle);
+            throw_error("mapped_file get size fails");
+        }
+
+        if (file_size.QuadPart != 0)
+        {
+            HANDLE mapping_handle = ::CreateFileMappingW(file_handle, nullptr, is_write ? PAGE_READWRITE : PAGE_READONLY, file_size.HighPart, file_size.LowPart, nullptr);
+            if (mapping_handle == nullptr)
+            {
+                ::CloseHandle(file_handle);
+                throw_error("mapped_file create mapping fails");
+            }
+
+            data_ = ::MapViewOfFile(mapping_handle, is_write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+            ::CloseHandle(mapping_handle);
+            if (data_ == nullptr)
+            {
+                ::CloseHandle(file_handle);
+                throw_error("mapped_file map fails");
+            }
+        }
+        ::CloseHandle(file_handle);
+        size_ = static_cast<std::size_t>(file_size.QuadPart);
+#else
+        auto throw_error = [&](const char* what) {
+            throw std::system_error(errno, std::generic_category(), std::string(what) + " : " + path.string());
+        };
+
+        int flags = is_write ? O_RDWR : O_RDONLY;
+        if (is_create)
+            flags |= O_CREAT | O_TRUNC;
+        const int file_descriptor = ::open(path.c_str(), flags | O_CLOEXEC, 0644); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (file_descriptor < 0)
+            throw_error("mapped_file open fails");
+
+        struct ::stat file_stat {};
+        if (is_create ? ::ftruncate(file_descriptor, static_cast<off_t>(size)) != 0 : ::fstat(file_descriptor, &file_stat) != 0)
+        {
+            auto error = errno;
+            ::close(file_descriptor);
+            errno = error;
+            throw_error("mapped_file get size fails");
+        }
+        const auto file_size = is_create ? size : static_cast<std::size_t>(file_stat.st_size);
+
+        if (file_size != 0)
+        {
+            void* address = ::mmap(nullptr, file_size, is_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file_descriptor, 0);
+            if (address == MAP_FAILED)
+            {
+                auto error = errno;
+                ::close(file_descriptor);
+                errno = error;
+                throw_error("mapped_file map fails");
+            }
+            data_ = address;
+        }
+        ::close(file_descriptor);
+        size_ = file_size;
+#endif
+    }
+
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    access_mode mode_ = access_mode::read_only;
+};
+
+} // namespace lot
\ No newline at end of file
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "base.h"
+#include "simd.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <sys/uio.h>
+#    include <unistd.h>
+#endif
+
+namespace lot {
+
+namespace detail {
+
+    // Move `count` elements from `src` to `dst`, the ranges may overlap
+    template <typename T>
+    void move_span(T* dst, const T* src, std::size_t count)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            std::memmove(dst, src, count * sizeof(T));
+        } else {
+            if (dst < src)
+                std::move(const_cast<T*>(src), const_cast<T*>(src) + count, dst); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+            else if (dst > src)
+                std::move_backward(const_cast<T*>(src), const_cast<T*>(src) + count, dst + count); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        }
+    }
+
+    template <typename T>
+    void fill_span(T* dst, std::size_t count, const T& value)
+    {
+        if constexpr (sizeof(T) == 1 && std::is_trivially_copyable_v<T>)
+            std::memset(dst, static_cast<unsigned char>(value), count);
+        else
+            std::fill_n(dst, count, value);
+    }
+
+    /**
+     * @brief Fill a rectangle of a row-major plane, one memset/fill per row
+     *
+     * @param stride Number of elements in one row of the plane
+     */
+    template <typename T>
+    void fill_rect(T* data, std::size_t stride, std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, const T& value)
+    {
+        for (std::uint32_t row = pos_y; row < pos_y + rect_height; ++row)
+            fill_span(data + row * stride + pos_x, rect_width, value);
+    }
+
+    // Copy a rectangle between two planes that don't overlap, one memcpy/copy per row
+    template <typename T>
+    void copy_rect(T* dst, std::size_t dst_stride, const T* src, std::size_t src_stride, std::uint32_t rect_width, std::uint32_t rect_height)
+    {
+        for (std::uint32_t row = 0; row < rect_height; ++row)
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+                std::memcpy(dst + row * dst_stride, src + row * src_stride, rect_width * sizeof(T));
+            else
+                std::copy_n(src + row * src_stride, rect_width, dst + row * dst_stride);
+        }
+    }
+
+    /**
+     * @brief Describe how content inside a rectangle moves by (offset_x, offset_y).
+     * Calls `move_func(dst_x, dst_y, src_x, src_y, count)` for every row that stays inside the rectangle, in an order
+     * that is safe when moving in place, then `clear_func(pos_x, pos_y, count)` for every span that was vacated
+     */
+    template <typename MoveFunc, typename ClearFunc>
+    void for_each_scroll_span(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, std::int64_t offset_x, std::int64_t offset_y, MoveFunc&& move_func, ClearFunc&& clear_func)
+    {
+        const auto abs_x = static_cast<std::uint64_t>(offset_x < 0 ? -offset_x : offset_x);
+        const auto abs_y = static_cast<std::uint64_t>(offset_y < 0 ? -offset_y : offset_y);
+        if (abs_x >= rect_width || abs_y >= rect_height)
+        {
+            for (std::uint32_t row = pos_y; row < pos_y + rect_height; ++row)
+                clear_func(pos_x, row, rect_width);
+            return;
+        }
+
+        const auto copy_width = static_cast<std::uint32_t>(rect_width - abs_x);
+        const auto copy_height = static_cast<std::uint32_t>(rect_height - abs_y);
+        const std::uint32_t src_x = pos_x + (offset_x < 0 ? static_cast<std::uint32_t>(abs_x) : 0);
+        const std::uint32_t dst_x = pos_x + (offset_x > 0 ? static_cast<std::uint32_t>(abs_x) : 0);
+        const std::uint32_t src_y = pos_y + (offset_y < 0 ? static_cast<std::uint32_t>(abs_y) : 0);
+        const std::uint32_t dst_y = pos_y + (offset_y > 0 ? static_cast<std::uint32_t>(abs_y) : 0);
+
+        if (offset_y > 0)
+        {
+            for (std::uint32_t index = copy_height; index-- > 0;)
+                move_func(dst_x, dst_y + index, src_x, src_y + index, copy_width);
+        } else {
+            for (std::uint32_t index = 0; index < copy_height; ++index)
+                move_func(dst_x, dst_y + index, src_x, src_y + index, copy_width);
+        }
+
+        // Vacated rows
+        const std::uint32_t clear_y = offset_y > 0 ? pos_y : pos_y + copy_height;
+        for (std::uint32_t row = clear_y; row < clear_y + abs_y; ++row)
+            clear_func(pos_x, row, rect_width);
+
+        // Vacated columus of the moved rows
+        if (abs_x != 0)
+        {
+            const std::uint32_t clear_x = offset_x > 0 ? pos_x : pos_x + copy_width;
+            for (std::uint32_t row = dst_y; row < dst_y + copy_height; ++row)
+                clear_func(clear_x, row, static_cast<std::uint32_t>(abs_x));
+        }
+    }
+
+    // Move the content of a rectangle by (offset_x, offset_y) in place, vacated cells are set to `fill_value`
+    template <typename T>
+    void scroll_rect(T* data, std::size_t stride, std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, std::int64_t offset_x, std::int64_t offset_y, const T& fill_value)
+    {
+        for_each_scroll_span(
+            pos_x, pos_y, rect_width, rect_height, offset_x, offset_y,
+            [&](std::uint32_t dst_x, std::uint32_t dst_y, std::uint32_t src_x, std::uint32_t src_y, std::uint32_t count) {
+                move_span(data + dst_y * stride + dst_x, data + src_y * stride + src_x, count);
+            },
+            [&](std::uint32_t clear_x, std::uint32_t clear_y, std::uint32_t count) {
+                fill_span(data + clear_y * stride + clear_x, count, fill_value);
+            });
+    }
+
+    [[nodiscard]] inline bool get_bit(const std::uint64_t* bits, std::size_t index) noexcept
+    {
+        return (bits[index / 64] >> (index % 64) & 1U) != 0;
+    }
+
+    inline void set_bit(std::uint64_t* bits, std::size_t index, bool value) noexcept
+    {
+        if (value)
+            bits[index / 64] |= std::uint64_t(1) << (index % 64);
+        else
+            bits[index / 64] &= ~(std::uint64_t(1) << (index % 64));
+    }
+
+    inline void fill_bits(std::uint64_t* bits, std::size_t index, std::size_t count, bool value) noexcept
+    {
+        for (; count != 0 && index % 64 != 0; ++index, --count)
+            set_bit(bits, index, value);
+        for (; count >= 64; index += 64, count -= 64)
+            bits[index / 64] = value ? ~std::uint64_t(0) : 0;
+        for (; count != 0; ++index, --count)
+            set_bit(bits, index, value);
+    }
+
+    // Move `count` bits from `src_index` to `dst_index`, the ranges may overlap
+    inline void move_bits(std::uint64_t* bits, std::size_t dst_index, std::size_t src_index, std::size_t count) noexcept
+    {
+        if (dst_index < src_index)
+        {
+            for (std::size_t index = 0; index < count; ++index)
+                set_bit(bits, dst_index + index, get_bit(bits, src_index + index));
+        } else if (dst_index > src_index) {
+            for (std::size_t index = count; index-- > 0;)
+                set_bit(bits, dst_index + index, get_bit(bits, src_index + index));
+        }
+    }
+
+    // Return the mask of bytes in [ptr, ptr + N) that are equal to `target`, N is 32 for AVX2 and 16 for SSE2
+#if defined(LOT_SIMD_AVX2)
+    [[nodiscard]] inline std::uint32_t match_mask_32(const char* ptr, __m256i pattern) noexcept
+    {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+    }
+#endif
+
+#if defined(LOT_SIMD_SSE2)
+    [[nodiscard]] inline std::uint32_t match_mask_16(const char* ptr, __m128i pattern) noexcept
+    {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern)));
+    }
+#endif
+
+    // Count the characters equal to `target` in [ptr, ptr + count)
+    [[nodiscard]] inline std::size_t count_char(const char* ptr, std::size_t count, char target) noexcept
+    {
+        std::size_t result = 0;
+        std::size_t index = 0;
+#if defined(LOT_SIMD_AVX2)
+        const auto pattern_32 = _mm256_set1_epi8(target);
+        for (; index + 32 <= count; index += 32)
+            result += std::popcount(match_mask_32(ptr + index, pattern_32));
+#endif
+#if defined(LOT_SIMD_SSE2)
+        const auto pattern_16 = _mm_set1_epi8(target);
+        for (; index + 16 <= count; index += 16)
+            result += std::popcount(match_mask_16(ptr + index, pattern_16));
+#endif
+        for (; index < count; ++index)
+            result += static_cast<std::size_t>(ptr[index] == target);
+        return result;
+    }
+
+    /**
+     * @brief Find the first character in [ptr, ptr + count) that is equal to `target`, or not equal to it when `is_equal` is false
+     *
+     * @return Index of the character, `count` if there is none
+     */
+    template <bool is_equal = true>
+    [[nodiscard]] std::size_t find_char(const char* ptr, std::size_t count, char target) noexcept
+    {
+        [[maybe_unused]] constexpr auto select = [](std::uint32_t mask, std::uint32_t full) { return is_equal ? mask : (~mask & full); };
+        std::size_t index = 0;
+#if defined(LOT_SIMD_AVX2)
+        const auto pattern_32 = _mm256_set1_epi8(target);
+        for (; index + 32 <= count; index += 32)
+            if (auto mask = select(match_mask_32(ptr + index, pattern_32), 0xFFFFFFFFU); mask != 0)
+                return index + std::countr_zero(mask);
+#endif
+#if defined(LOT_SIMD_SSE2)
+        const auto pattern_16 = _mm_set1_epi8(target);
+        for (; index + 16 <= count; index += 16)
+            if (auto mask = select(match_mask_16(ptr + index, pattern_16), 0xFFFFU); mask != 0)
+                return index + std::countr_zero(mask);
+#endif
+        for (; index < count; ++index)
+            if ((ptr[index] == target) == is_equal)
+                return index;
+        return count;
+    }
+
+    [[nodiscard]] inline std::size_t count_char_rect(const char* data, std::size_t stride, std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, char target) noexcept
+    {
+        // Full rows are contiguous, so count them in one go
+        if (rect_width == stride)
+            return count_char(data + pos_y * stride, stride * rect_height, target);
+
+        std::size_t result = 0;
+        for (std::uint32_t row = pos_y; row < pos_y + rect_height; ++row)
+            result += count_char(data + row * stride + pos_x, rect_width, target);
+        return result;
+    }
+
+    /**
+     * @brief Find the first character of a rectangle (in row-major order) that is equal to `target`,
+     * or not equal to it when `is_equal` is false
+     *
+     * @return Whether it is found, and its columu and row
+     */
+    template <bool is_equal = true>
+    [[nodiscard]] bool find_char_rect(const char* data, std::size_t stride, std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t rect_width, std::uint32_t rect_height, char target,
+        std::uint32_t& found_x, std::uint32_t& found_y) noexcept
+    {
+        for (std::uint32_t row = pos_y; row < pos_y + rect_height; ++row)
+        {
+            if (auto index = find_char<is_equal>(data + row * stride + pos_x, rect_width, target); index != rect_width)
+            {
+                found_x = pos_x + static_cast<std::uint32_t>(index);
+                found_y = row;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Add the occurrences of every byte in [ptr, ptr + count) to `histogram`
+    inline void add_histogram(const char* ptr, std::size_t count, std::array<std::size_t, 256>& histogram) noexcept
+    {
+        // Four interleaved tables break the store-to-load dependency when the same byte repeats,
+        // which is the common case for screens full of empty_char
+        constexpr std::size_t block_size = std::size_t(1) << 30;
+        std::array<std::array<std::uint32_t, 256>, 4> partial_list {};
+        const auto* bytes = reinterpret_cast<const unsigned char*>(ptr); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+        while (count != 0)
+        {
+            const std::size_t block_count = (std::min)(count, block_size);
+            std::size_t index = 0;
+            for (; index + 4 <= block_count; index += 4)
+            {
+                ++partial_list[0][bytes[index]];
+                ++partial_list[1][bytes[index + 1]];
+                ++partial_list[2][bytes[index + 2]];
+                ++partial_list[3][bytes[index + 3]];
+            }
+            for (; index < block_count; ++index)
+                ++partial_list[0][bytes[index]];
+
+            for (std::size_t value = 0; value < 256; ++value)
+            {
+                histogram[value] += std::size_t(partial_list[0][value]) + partial_list[1][value] + partial_list[2][value] + partial_list[3][value];
+                partial_list[0][value] = partial_list[1][value] = partial_list[2][value] = partial_list[3][value] = 0;
+            }
+
+            bytes += block_count;
+            count -= block_count;
+        }
+    }
+
+    // Append every row followed by '\n' to `frame_buffer`, the buffer is cleared first but keeps its capacity
+    inline void append_frame(std::string& frame_buffer, const char* data, std::size_t stride, std::uint32_t rect_width, std::uint32_t rect_height)
+    {
+        frame_buffer.clear();
+        frame_buffer.reserve((std::size_t(rect_width) + 1) * rect_height);
+        for (std::uint32_t row = 0; row < rect_height; ++row)
+        {
+            frame_buffer.append(data + row * stride, rect_width);
+            frame_buffer.push_back('\n');
+        }
+    }
+
+    inline void write_all(int file_descriptor, const char* ptr, std::size_t count)
+    {
+        while (count != 0)
+        {
+#ifdef _WIN32
+            auto written = ::_write(file_descriptor, ptr, static_cast<unsigned int>(std::min<std::size_t>(count, INT_MAX)));
+#else
+            auto written = ::write(file_descriptor, ptr, count);
+#endif
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "ascii_screen write fails");
+            }
+            ptr += written;
+            count -= static_cast<std::size_t>(written);
+        }
+    }
+
+    /**
+     * @brief Write every row followed by '\n' to a file descriptor. On POSIX the rows are gathered with `writev`,
+     * so a frame is usually a single syscall without copying, elsewhere the frame is built in a reused buffer first
+     */
+    inline void write_frame(int file_descriptor, const char* data, std::size_t stride, std::uint32_t rect_width, std::uint32_t rect_height)
+    {
+#ifdef _WIN32
+        thread_local std::string frame_buffer;
+        append_frame(frame_buffer, data, stride, rect_width, rect_height);
+        write_all(file_descriptor, frame_buffer.data(), frame_buffer.size());
+#else
+        static constexpr std::size_t max_iovec_count = IOV_MAX - IOV_MAX % 2;
+        static char newline = '\n';
+        std::array<::iovec, max_iovec_count> iovec_list {};
+
+        std::uint32_t row = 0;
+        while (row < rect_height)
+        {
+            std::size_t iovec_count = 0;
+            for (; row < rect_height && iovec_count < max_iovec_count; ++row)
+            {
+                iovec_list[iovec_count++] = { const_cast<char*>(data + row * stride), rect_width }; // NOLINT(cppcoreguidelines-pro-type-const-cast)
+                iovec_list[iovec_count++] = { &newline, 1 };
+            }
+
+            ::iovec* current = iovec_list.data();
+            while (iovec_count != 0)
+            {
+                auto written = ::writev(file_descriptor, current, static_cast<int>(iovec_count));
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::system_error(errno, std::generic_category(), "ascii_screen writev fails");
+                }
+
+                // Skip what was written, a partial write can stop in the middle of an iovec
+                auto remain = static_cast<std::size_t>(written);
+                while (iovec_count != 0 && remain >= current->iov_len)
+                {
+                    remain -= current->iov_len;
+                    ++current;
+                    --iovec_count;
+                }
+                if (iovec_count != 0)
+                {
+                    current->iov_base = static_cast<char*>(current->iov_base) + remain;
+                    current->iov_len -= remain;
+                }
+            }
+        }
+#endif
+    }
+
+} // namespace detail
+
+} // namespace lot
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "base.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <thread>
+#include <utility>
+
+namespace lot {
+
+struct presenter_stats
+{
+    std::uint64_t presented_frames = 0;
+    std::uint64_t dropped_frames = 0;
+    std::chrono::nanoseconds last_frame_time {};
+    std::chrono::nanoseconds max_frame_time {};
+    std::chrono::nanoseconds total_frame_time {};
+};
+
+/**
+ * @brief Owns two or three screens and presents them on a dedicated thread, the producer draws into `back()`
+ * and calls `swap()` without waiting for the output. The handoff is lock-free and the latest frame wins:
+ *  - With three buffers a frame that is still waiting when a newer one is swapped in gets dropped,
+ *    after `swap()` the back buffer holds an older frame, so redraw it completely.
+ *  - With two buffers `swap()` drops the frame when the presenter is still busy, the back buffer is kept as is
+ *    so the producer can keep drawing on it.
+ *
+ * @tparam Screen Screen type, e.g. ascii_screen, must be default constructible
+ * @tparam buffer_count 2 or 3
+ */
+template <typename Screen, std::size_t buffer_count = 3>
+class screen_presenter
+{
+    static_assert(buffer_count == 2 || buffer_count == 3, "buffer_count must be 2 or 3!");
+
+public:
+    using present_function = std::function<void(Screen&)>;
+
+    screen_presenter(const screen_presenter&) = delete;
+    screen_presenter(screen_presenter&&) = delete;
+    screen_presenter& operator=(const screen_presenter&) = delete;
+    screen_presenter& operator=(screen_presenter&&) = delete;
+
+    explicit screen_presenter(std::ostream& out)
+        : screen_presenter([&out](Screen& screen) {
+              screen.show(out);
+              out.flush();
+          })
+    {
+    }
+
+    explicit screen_presenter(present_function present_func)
+        : present_func_(std::move(present_func))
+    {
+        if constexpr (buffer_count == 3)
+            state_.store(2);
+        present_thread_ = std::jthread([this] { present_loop(); });
+    }
+
+    ~screen_presenter()
+    {
+        state_.fetch_or(stop_bit);
+        state_.notify_one();
+    }
+
+    // The screen owned by the producer
+    [[nodiscard]] Screen& back() noexcept
+    {
+        return buffers_[back_];
+    }
+
+    // Hand the back buffer to the presenter thread, never blocks
+    screen_presenter& swap()
+    {
+        if constexpr (buffer_count == 3)
+        {
+            auto old_state = state_.exchange(back_ | fresh_bit, std::memory_order_acq_rel);
+            if ((old_state & fresh_bit) != 0)
+                dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            back_ = old_state & index_mask;
+        } else {
+            if ((state_.load(std::memory_order_acquire) & index_mask) != idle)
+            {
+                dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+                return *this;
+            }
+            std::swap(back_, front_);
+            state_.fetch_add(1, std::memory_order_release); // idle -> pending
+        }
+
+        state_.notify_one();
+        return *this;
+    }
+
+    [[nodiscard]] presenter_stats get_stats() const noexcept
+    {
+        presenter_stats stats;
+        stats.presented_frames = presented_frames_.load(std::memory_order_relaxed);
+        stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+        stats.last_frame_time = std::chrono::nanoseconds(last_frame_time_.load(std::memory_order_relaxed));
+        stats.max_frame_time = std::chrono::nanoseconds(max_frame_time_.load(std::memory_order_relaxed));
+        stats.total_frame_time = std::chrono::nanoseconds(total_frame_time_.load(std::memory_order_relaxed));
+        return stats;
+    }
+
+private:
+    // Three buffers: the state is the index of the middle buffer plus a fresh flag.
+    // Two buffers: the state is idle -> pending -> presenting -> idle, only the producer leaves idle
+    static constexpr std::uint32_t index_mask = 3;
+    static constexpr std::uint32_t fresh_bit = 4;
+    static constexpr std::uint32_t stop_bit = 8;
+    static constexpr std::uint32_t idle = 0;
+    static constexpr std::uint32_t pending = 1;
+
+    // Wait until a frame is ready and take it, return false when stopped
+    bool acquire_frame()
+    {
+        auto current_state = state_.load(std::memory_order_acquire);
+        while (true)
+        {
+            if ((current_state & stop_bit) != 0)
+                return false;
+
+            if constexpr (buffer_count == 3)
+            {
+                if ((current_state & fresh_bit) != 0)
+                {
+                    if (state_.compare_exchange_weak(current_state, front_, std::memory_order_acq_rel))
+                    {
+                        front_ = current_state & index_mask;
+                        return true;
+                    }
+                    continue;
+                }
+            } else {
+                if ((current_state & index_mask) == pending)
+                {
+                    state_.fetch_add(1, std::memory_order_acq_rel); // pending -> presenting
+                    return true;
+                }
+            }
+
+            state_.wait(current_state, std::memory_order_acquire);
+            current_state = state_.load(std::memory_order_acquire);
+        }
+    }
+
+    void present_loop()
+    {
+        while (acquire_frame())
+        {
+            auto start_time = std::chrono::steady_clock::now();
+            present_func_(buffers_[front_]);
+            auto frame_time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count());
+
+            if constexpr (buffer_count == 2)
+                state_.fetch_sub(2, std::memory_order_release); // presenting -> idle
+
+            presented_frames_.fetch_add(1, std::memory_order_relaxed);
+            last_frame_time_.store(frame_time, std::memory_order_relaxed);
+            total_frame_time_.fetch_add(frame_time, std::memory_order_relaxed);
+            if (frame_time > max_frame_time_.load(std::memory_order_relaxed))
+                max_frame_time_.store(frame_time, std::memory_order_relaxed);
+        }
+    }
+
+    std::array<Screen, buffer_count> buffers_;
+    present_function present_func_;
+    std::uint32_t back_ = 0;
+    std::uint32_t front_ = 1;
+    std::atomic<std::uint32_t> state_ = 0;
+    std::atomic<std::uint64_t> presented_frames_ = 0;
+    std::atomic<std::uint64_t> dropped_frames_ = 0;
+    std::atomic<std::uint64_t> last_frame_time_ = 0;
+    std::atomic<std::uint64_t> max_frame_time_ = 0;
+    std::atomic<std::uint64_t> total_frame_time_ = 0;
+    std::jthread present_thread_; // Declared last, so the thread is joined before the members above are destroyed
+};
+
+} // namespace lot
\ No newline at end of file
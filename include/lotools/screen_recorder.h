@@ -0,0 +1,396 @@
+#pragma once
+
+#include "ascii_screen.h"
+#include "base.h"
+#include "mapped_file.h"
+#include "screen_snapshot.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lot {
+
+/**
+ * @brief Header at the start of a recording. It is followed by records, each one is a record_header plus a delta frame
+ * (see delta_encoder). A keyframe is a delta frame that stores every cell, so it can be applied to any screen
+ */
+struct recording_header
+{
+    static constexpr std::array<char, 4> recording_magic = { 'L', 'O', 'T', 'R' };
+    static constexpr std::uint16_t current_version = 1;
+
+    std::array<char, 4> magic = recording_magic;
+    std::uint16_t version = current_version;
+    std::uint16_t reserved = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+};
+
+struct record_header
+{
+    // Values of `flags`
+    static constexpr std::uint32_t is_keyframe = 1;
+
+    std::uint32_t payload_size = 0;
+    std::uint32_t flags = 0;
+    std::int64_t timestamp = 0; // Nanoseconds since the start of the recording
+};
+
+// An entry of the seek index, which is stored beside the recording in "<recording>.idx", one entry per keyframe
+struct keyframe_index_entry
+{
+    std::int64_t timestamp = 0;
+    std::uint64_t offset = 0; // Offset of the record_header in the recording
+};
+
+static_assert(sizeof(recording_header) == 16 && sizeof(record_header) == 16 && sizeof(keyframe_index_entry) == 16);
+
+namespace detail {
+
+    inline std::filesystem::path get_recording_index_path(const std::filesystem::path& path)
+    {
+        auto index_path = path;
+        index_path += ".idx";
+        return index_path;
+    }
+
+} // namespace detail
+
+/**
+ * @brief Record a session of ascii_screen frames to an append-only file. `record()` only diffs the frame against the
+ * previous one into a buffer, the file is written by a background thread so the render loop never waits on the disk.
+ * A keyframe is written every `keyframe_interval` frames and added to the seek index
+ *
+ * @tparam width Width of the recorded screen
+ * @tparam height Height of the recorded screen
+ */
+template <std::uint32_t width, std::uint32_t height>
+class screen_recorder
+{
+public:
+    screen_recorder(const screen_recorder&) = delete;
+    screen_recorder(screen_recorder&&) = delete;
+    screen_recorder& operator=(const screen_recorder&) = delete;
+    screen_recorder& operator=(screen_recorder&&) = delete;
+
+    /**
+     * @param path The recording is created (or replaced) at `path`, the seek index at "<path>.idx"
+     * @param keyframe_interval Number of frames between two keyframes, a seek applies at most this many delta frames
+     */
+    explicit screen_recorder(const std::filesystem::path& path, std::uint32_t keyframe_interval = 300)
+        : recording_file_(path, std::ios::binary | std::ios::trunc), index_file_(detail::get_recording_index_path(path), std::ios::binary | std::ios::trunc),
+          keyframe_interval_(std::max<std::uint32_t>(keyframe_interval, 1)), start_time_(std::chrono::steady_clock::now())
+    {
+        if (!recording_file_ || !index_file_)
+            throw snapshot_error("screen_recorder open fails : " + path.string());
+
+        recording_header header;
+        header.width = width;
+        header.height = height;
+        recording_file_.write(reinterpret_cast<const char*>(&header), sizeof(header)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        file_offset_ = sizeof(header);
+
+        writer_thread_ = std::jthread([this](std::stop_token stop_token) { write_loop(stop_token); });
+    }
+
+    ~screen_recorder()
+    {
+        writer_thread_.request_stop();
+        writer_thread_ = {}; // Join, the remaining records are written before the thread exits
+    }
+
+    // Record a frame with the time elapsed since the recorder was created
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    screen_recorder& record(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen)
+    {
+        return record(screen, std::chrono::steady_clock::now() - start_time_);
+    }
+
+    /**
+     * @brief Record a frame at `timestamp`, timestamps must not decrease. Throw if the background writer failed,
+     * the error is reported once and the frames after it are lost
+     */
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    screen_recorder& record(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::chrono::nanoseconds timestamp)
+    {
+        pending_record record;
+        {
+            std::lock_guard lock(mutex_);
+            rethrow_writer_error();
+            if (!free_list_.empty())
+            {
+                record.data = std::move(free_list_.back());
+                free_list_.pop_back();
+            }
+        }
+
+        record.is_keyframe = frame_count_ % keyframe_interval_ == 0;
+        record.timestamp = timestamp.count();
+        if (record.is_keyframe)
+            encoder_.reset();
+
+        record_header header;
+        header.flags = record.is_keyframe ? record_header::is_keyframe : 0;
+        header.timestamp = record.timestamp;
+        record.data.clear();
+        record.data.append(reinterpret_cast<const char*>(&header), sizeof(header)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        encoder_.encode(screen, record.data);
+        header.payload_size = static_cast<std::uint32_t>(record.data.size() - sizeof(header));
+        std::memcpy(record.data.data(), &header, sizeof(header));
+        ++frame_count_;
+
+        {
+            std::lock_guard lock(mutex_);
+            pending_list_.push_back(std::move(record));
+        }
+        condition_.notify_one();
+        return *this;
+    }
+
+    // Wait until every recorded frame is written to the file
+    void flush()
+    {
+        std::unique_lock lock(mutex_);
+        condition_.notify_one();
+        flushed_condition_.wait(lock, [this] { return pending_list_.empty() && !is_writing_; });
+        rethrow_writer_error();
+    }
+
+    [[nodiscard]] std::uint64_t get_frame_count() const noexcept
+    {
+        return frame_count_;
+    }
+
+private:
+    struct pending_record
+    {
+        std::string data;
+        std::int64_t timestamp = 0;
+        bool is_keyframe = false;
+    };
+
+    void rethrow_writer_error()
+    {
+        if (writer_error_)
+            std::rethrow_exception(std::exchange(writer_error_, nullptr));
+    }
+
+    void write_loop(std::stop_token stop_token)
+    {
+        std::vector<pending_record> write_list;
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                for (auto& record : write_list)
+                    free_list_.push_back(std::move(record.data));
+                write_list.clear();
+                is_writing_ = false;
+                flushed_condition_.notify_all();
+
+                condition_.wait(lock, stop_token, [this] { return !pending_list_.empty(); });
+                if (pending_list_.empty())
+                    return; // Stop requested and everything is written
+                write_list.swap(pending_list_);
+                is_writing_ = true;
+            }
+
+            try {
+                for (const auto& record : write_list)
+                {
+                    recording_file_.write(record.data.data(), static_cast<std::streamsize>(record.data.size()));
+                    if (record.is_keyframe)
+                    {
+                        const keyframe_index_entry entry { record.timestamp, file_offset_ };
+                        index_file_.write(reinterpret_cast<const char*>(&entry), sizeof(entry)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+                    }
+                    file_offset_ += record.data.size();
+                }
+                // The recording is flushed first, so the index never points past the end of the recording
+                recording_file_.flush();
+                index_file_.flush();
+                if (!recording_file_ || !index_file_)
+                    throw snapshot_error("screen_recorder write fails");
+            } catch (...) {
+                std::lock_guard lock(mutex_);
+                writer_error_ = std::current_exception();
+            }
+        }
+    }
+
+    // Used by the render thread only
+    delta_encoder<width, height> encoder_;
+    std::uint64_t frame_count_ = 0;
+
+    // Used by the writer thread only
+    std::ofstream recording_file_;
+    std::ofstream index_file_;
+    std::uint64_t file_offset_ = 0;
+
+    // Shared, guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable_any condition_;
+    std::condition_variable_any flushed_condition_;
+    std::vector<pending_record> pending_list_;
+    std::vector<std::string> free_list_; // Buffers of written records, reused to avoid allocation per frame
+    std::exception_ptr writer_error_;
+    bool is_writing_ = false;
+
+    std::uint32_t keyframe_interval_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::jthread writer_thread_; // Declared last, so the thread is joined before the members above are destroyed
+};
+
+/**
+ * @brief Replay a recording written by screen_recorder. The recording is mapped read-only, `seek` jumps to any
+ * timestamp by applying the nearest keyframe before it and the delta frames up to it. A missing or stale seek
+ * index is completed by scanning the records after its last entry
+ *
+ * @tparam width Width of the recorded screen
+ * @tparam height Height of the recorded screen
+ */
+template <std::uint32_t width, std::uint32_t height>
+class screen_player
+{
+public:
+    explicit screen_player(const std::filesystem::path& path)
+        : file_(path)
+    {
+        recording_header header;
+        if (file_.size() < sizeof(header))
+            throw snapshot_error("recording is truncated : " + path.string());
+        std::memcpy(&header, file_.data(), sizeof(header));
+        if (header.magic != recording_header::recording_magic || header.version != recording_header::current_version)
+            throw snapshot_error("recording has a bad header : " + path.string());
+        if (header.width != width || header.height != height)
+            throw snapshot_error("recording size " + std::to_string(header.width) + "x" + std::to_string(header.height) + " doesn't match the screen");
+
+        load_index(detail::get_recording_index_path(path));
+        rewind();
+    }
+
+    // Timestamp of the last frame
+    [[nodiscard]] std::chrono::nanoseconds get_duration() const noexcept
+    {
+        return std::chrono::nanoseconds(last_timestamp_);
+    }
+
+    // Timestamp of the frame applied last, -1ns before the first frame
+    [[nodiscard]] std::chrono::nanoseconds get_timestamp() const noexcept
+    {
+        return std::chrono::nanoseconds(current_timestamp_);
+    }
+
+    [[nodiscard]] std::size_t get_keyframe_count() const noexcept
+    {
+        return keyframe_list_.size();
+    }
+
+    /**
+     * @brief Show the last frame whose timestamp is not after `timestamp`, return false when `timestamp` is
+     * before the first frame (the screen is not changed then)
+     */
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    bool seek(ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::chrono::nanoseconds timestamp)
+    {
+        const auto target = timestamp.count();
+        auto iter = std::upper_bound(keyframe_list_.begin(), keyframe_list_.end(), target, [](std::int64_t value, const keyframe_index_entry& entry) { return value < entry.timestamp; });
+        if (iter == keyframe_list_.begin())
+            return false;
+
+        // Continue from the current frame when it is past the keyframe, a forward seek doesn't start over
+        const auto& keyframe = *std::prev(iter);
+        if (!(position_ > keyframe.offset && current_timestamp_ <= target))
+            position_ = keyframe.offset;
+
+        while (position_ < end_offset_)
+        {
+            const auto header = read_record_header(position_);
+            if (header.timestamp > target)
+                break;
+            next(screen);
+        }
+        return true;
+    }
+
+    // Apply the next frame, return false at the end of the recording
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    bool next(ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen)
+    {
+        if (position_ >= end_offset_)
+            return false;
+
+        const auto header = read_record_header(position_);
+        apply_delta(screen, file_.data() + position_ + sizeof(header), header.payload_size);
+        current_timestamp_ = header.timestamp;
+        position_ += sizeof(header) + header.payload_size;
+        return true;
+    }
+
+    // Go back before the first frame, the next call of `next` applies the first keyframe
+    void rewind() noexcept
+    {
+        position_ = keyframe_list_.empty() ? end_offset_ : keyframe_list_.front().offset;
+        current_timestamp_ = -1;
+    }
+
+private:
+    [[nodiscard]] record_header read_record_header(std::uint64_t offset) const noexcept
+    {
+        record_header header;
+        std::memcpy(&header, file_.data() + offset, sizeof(header));
+        return header;
+    }
+
+    void load_index(const std::filesystem::path& index_path)
+    {
+        // Take the entries of the index that point to complete keyframes
+        std::ifstream index_file(index_path, std::ios::binary);
+        keyframe_index_entry entry;
+        while (index_file.read(reinterpret_cast<char*>(&entry), sizeof(entry))) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        {
+            if (entry.offset + sizeof(record_header) > file_.size() || (!keyframe_list_.empty() && entry.offset <= keyframe_list_.back().offset))
+                break;
+            const auto header = read_record_header(entry.offset);
+            if ((header.flags & record_header::is_keyframe) == 0 || entry.offset + sizeof(header) + header.payload_size > file_.size())
+                break;
+            keyframe_list_.push_back(entry);
+        }
+
+        // Scan the records the index doesn't cover, a crashed recorder may have written records after the last entry
+        std::uint64_t offset = keyframe_list_.empty() ? sizeof(recording_header) : keyframe_list_.back().offset;
+        while (offset + sizeof(record_header) <= file_.size())
+        {
+            const auto header = read_record_header(offset);
+            if (offset + sizeof(header) + header.payload_size > file_.size())
+                break; // Truncated record
+            if ((header.flags & record_header::is_keyframe) != 0 && (keyframe_list_.empty() || offset > keyframe_list_.back().offset))
+                keyframe_list_.push_back({ header.timestamp, offset });
+            last_timestamp_ = header.timestamp;
+            offset += sizeof(header) + header.payload_size;
+        }
+        end_offset_ = offset;
+    }
+
+    mapped_file file_;
+    std::vector<keyframe_index_entry> keyframe_list_;
+    std::uint64_t end_offset_ = 0;
+    std::uint64_t position_ = 0;
+    std::int64_t last_timestamp_ = 0;
+    std::int64_t current_timestamp_ = -1;
+};
+
+} // namespace lot
\ No newline at end of file
@@ -0,0 +1,577 @@
+#pragma once
+
+#include "ascii_screen.h"
+#include "base.h"
+#include "colors.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace lot {
+
+class snapshot_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Header of a binary screen snapshot. The file is the header followed by the planes, each plane starts
+ * at a multiple of `plane_alignment`: the char plane, then the optional attribute, addition data and presence planes.
+ * Values are stored in native byte order, a snapshot from a machine of the other endianness is rejected
+ */
+struct snapshot_header
+{
+    static constexpr std::array<char, 4> snapshot_magic = { 'L', 'O', 'T', 'S' };
+    static constexpr std::uint16_t current_version = 2; // 2 added addition_tag
+    static constexpr std::size_t plane_alignment = 16;
+
+    // Values of `flags`
+    static constexpr std::uint16_t has_attribute_plane = 1;
+    static constexpr std::uint16_t has_addition_plane = 2;
+    static constexpr std::uint16_t has_presence_plane = 4;
+    static constexpr std::uint16_t is_big_endian = 8;
+
+    std::array<char, 4> magic = snapshot_magic;
+    std::uint16_t version = current_version;
+    std::uint16_t flags = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t addition_size = 0; // sizeof an element of the addition data plane
+    std::uint32_t addition_tag = 0;  // snapshot_addition_tag of the element type
+};
+
+static_assert(sizeof(snapshot_header) == 24 && std::is_trivially_copyable_v<snapshot_header>);
+
+/**
+ * @brief Identify the addition data type of a snapshot, the plane is only read back as a type with the same tag and size.
+ * Arithmetic and enum types get a tag from their kind, so an int32_t plane is never read as float. Other types are 0
+ * and only match by size, specialize the tag to tell them apart, e.g.
+ * `template <> inline constexpr std::uint32_t lot::snapshot_addition_tag<my_cell> = 0x10000;`
+ */
+template <typename T>
+inline constexpr std::uint32_t snapshot_addition_tag = [] {
+    if constexpr (std::is_enum_v<T>)
+        return snapshot_addition_tag<std::underlying_type_t<T>> | 0x800U;
+    else if constexpr (std::is_arithmetic_v<T>)
+        return static_cast<std::uint32_t>(0x100U | sizeof(T) | (std::is_signed_v<T> ? 0x40U : 0U) | (std::is_floating_point_v<T> ? 0x80U : 0U) | (std::is_same_v<T, bool> ? 0x200U : 0U));
+    else
+        return std::uint32_t { 0 };
+}();
+
+/**
+ * @brief Header of a delta frame, it is followed by `span_count` spans of changed cells. A span is its first cell index
+ * and its length (two uint32), then the characters and, when `has_attribute_spans` is set, the attributes of the cells
+ */
+struct delta_frame_header
+{
+    // Values of `flags`
+    static constexpr std::uint16_t has_attribute_spans = 1;
+
+    std::uint32_t cell_count = 0;
+    std::uint32_t span_count = 0;
+    std::uint32_t payload_size = 0; // Bytes following the header
+    std::uint16_t flags = 0;
+    std::uint16_t reserved = 0;
+};
+
+static_assert(sizeof(delta_frame_header) == 16 && std::is_trivially_copyable_v<delta_frame_header>);
+
+namespace detail {
+
+    template <typename Screen>
+    struct snapshot_traits;
+
+    // Only dense planes of trivially copyable addition data are stored, sparse addition data is not part of a snapshot
+    template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    struct snapshot_traits<ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>>
+    {
+        template <typename>
+        struct dense_storage : std::false_type
+        {
+            static constexpr bool is_track_presence = false;
+        };
+
+        template <typename T, bool is_track_presence_value>
+        struct dense_storage<dense_addition<T, is_track_presence_value>> : std::bool_constant<std::is_trivially_copyable_v<T>>
+        {
+            static constexpr bool is_track_presence = is_track_presence_value;
+        };
+
+        static constexpr bool has_attribute = is_add_attribute;
+        static constexpr bool has_addition = is_add_addition && dense_storage<AdditionStorage>::value;
+        static constexpr bool has_presence = has_addition && dense_storage<AdditionStorage>::is_track_presence;
+        static constexpr std::size_t addition_size = has_addition ? sizeof(typename AdditionStorage::value_type) : 0;
+        static constexpr std::uint32_t addition_tag = has_addition ? snapshot_addition_tag<typename AdditionStorage::value_type> : 0;
+    };
+
+    // Saturating size arithmetic, SIZE_MAX stands for an overflow and stays SIZE_MAX
+    constexpr std::size_t snapshot_size_add(std::size_t lhs, std::size_t rhs) noexcept
+    {
+        return lhs > SIZE_MAX - rhs ? SIZE_MAX : lhs + rhs;
+    }
+
+    constexpr std::size_t snapshot_size_multiply(std::size_t lhs, std::size_t rhs) noexcept
+    {
+        if (lhs == SIZE_MAX || rhs == SIZE_MAX)
+            return SIZE_MAX;
+        return rhs != 0 && lhs > SIZE_MAX / rhs ? SIZE_MAX : lhs * rhs;
+    }
+
+    constexpr std::size_t align_snapshot_offset(std::size_t offset) noexcept
+    {
+        return snapshot_size_add(offset, snapshot_header::plane_alignment - 1) / snapshot_header::plane_alignment * snapshot_header::plane_alignment;
+    }
+
+    // Offsets of the planes described by a header, 0 for absent planes. The header may come from an untrusted file,
+    // total_size is SIZE_MAX when the planes don't fit in std::size_t
+    struct snapshot_layout
+    {
+        std::size_t attribute_offset = 0;
+        std::size_t addition_offset = 0;
+        std::size_t presence_offset = 0;
+        std::size_t total_size = 0;
+
+        static constexpr std::size_t char_offset = align_snapshot_offset(sizeof(snapshot_header));
+
+        explicit snapshot_layout(const snapshot_header& header) noexcept
+        {
+            const std::size_t cell_count = snapshot_size_multiply(header.width, header.height);
+            std::size_t offset = snapshot_size_add(char_offset, cell_count);
+            if ((header.flags & snapshot_header::has_attribute_plane) != 0)
+            {
+                attribute_offset = align_snapshot_offset(offset);
+                offset = snapshot_size_add(attribute_offset, snapshot_size_multiply(cell_count, sizeof(text_attribute)));
+            }
+            if ((header.flags & snapshot_header::has_addition_plane) != 0)
+            {
+                addition_offset = align_snapshot_offset(offset);
+                offset = snapshot_size_add(addition_offset, snapshot_size_multiply(cell_count, header.addition_size));
+            }
+            if ((header.flags & snapshot_header::has_presence_plane) != 0)
+            {
+                presence_offset = align_snapshot_offset(offset);
+                offset = snapshot_size_add(presence_offset, snapshot_size_multiply(snapshot_size_add(cell_count, 63) / 64, sizeof(std::uint64_t)));
+            }
+            total_size = offset;
+        }
+    };
+
+    template <typename Screen>
+    snapshot_header make_snapshot_header(std::uint32_t width, std::uint32_t height) noexcept
+    {
+        using traits = snapshot_traits<Screen>;
+        snapshot_header header;
+        header.width = width;
+        header.height = height;
+        if constexpr (traits::has_attribute)
+            header.flags |= snapshot_header::has_attribute_plane;
+        if constexpr (traits::has_addition)
+            header.flags |= snapshot_header::has_addition_plane;
+        if constexpr (traits::has_presence)
+            header.flags |= snapshot_header::has_presence_plane;
+        if constexpr (std::endian::native == std::endian::big)
+            header.flags |= snapshot_header::is_big_endian;
+        header.addition_size = static_cast<std::uint32_t>(traits::addition_size);
+        header.addition_tag = traits::addition_tag;
+        return header;
+    }
+
+    // Call `func(row, start, end)` for every row piece of the cells [first, first + count) of a row-major plane
+    template <typename Func>
+    void for_each_row_piece(std::uint32_t width, std::size_t first, std::size_t count, Func&& func)
+    {
+        while (count != 0)
+        {
+            const auto row = static_cast<std::uint32_t>(first / width);
+            const auto start = static_cast<std::uint32_t>(first % width);
+            const auto piece = static_cast<std::uint32_t>(std::min<std::size_t>(count, width - start));
+            func(row, start, start + piece);
+            first += piece;
+            count -= piece;
+        }
+    }
+
+} // namespace detail
+
+/**
+ * @brief A validated, read-only view of a snapshot. It either borrows a buffer or maps a file, a mapped
+ * snapshot is never copied: the planes point straight into the mapping
+ */
+class snapshot_view
+{
+public:
+    snapshot_view(const char* data, std::size_t size)
+        : data_(data), size_(size)
+    {
+        validate();
+    }
+
+    explicit snapshot_view(const std::filesystem::path& path)
+        : file_(std::in_place, path), data_(std::as_const(*file_).data()), size_(file_->size())
+    {
+        validate();
+    }
+
+    [[nodiscard]] const snapshot_header& header() const noexcept
+    {
+        return header_;
+    }
+
+    [[nodiscard]] std::uint32_t width() const noexcept
+    {
+        return header_.width;
+    }
+
+    [[nodiscard]] std::uint32_t height() const noexcept
+    {
+        return header_.height;
+    }
+
+    // Number of bytes used by the snapshot, the buffer may be longer
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return detail::snapshot_layout(header_).total_size;
+    }
+
+    [[nodiscard]] const char* get_chars() const noexcept
+    {
+        return data_ + detail::snapshot_layout::char_offset;
+    }
+
+    [[nodiscard]] char get(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+    {
+        lo_assert(pos_x < header_.width && pos_y < header_.height);
+        return get_chars()[std::size_t(pos_y) * header_.width + pos_x];
+    }
+
+    [[nodiscard]] bool has_attribute_plane() const noexcept
+    {
+        return (header_.flags & snapshot_header::has_attribute_plane) != 0;
+    }
+
+    [[nodiscard]] text_attribute get_attribute(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+    {
+        lo_assert(pos_x < header_.width && pos_y < header_.height);
+        if (!has_attribute_plane())
+            return {};
+        text_attribute attribute;
+        std::memcpy(&attribute, data_ + detail::snapshot_layout(header_).attribute_offset + (std::size_t(pos_y) * header_.width + pos_x) * sizeof(text_attribute), sizeof(text_attribute));
+        return attribute;
+    }
+
+    [[nodiscard]] bool has_addition_plane() const noexcept
+    {
+        return (header_.flags & snapshot_header::has_addition_plane) != 0;
+    }
+
+    [[nodiscard]] bool has_addition_data(std::uint32_t pos_x, std::uint32_t pos_y) const noexcept
+    {
+        lo_assert(pos_x < header_.width && pos_y < header_.height);
+        if (!has_addition_plane())
+            return false;
+        if ((header_.flags & snapshot_header::has_presence_plane) == 0)
+            return true;
+
+        const std::size_t index = std::size_t(pos_y) * header_.width + pos_x;
+        std::uint64_t word = 0;
+        std::memcpy(&word, data_ + detail::snapshot_layout(header_).presence_offset + index / 64 * sizeof(std::uint64_t), sizeof(word));
+        return (word >> (index % 64) & 1U) != 0;
+    }
+
+    /**
+     * @brief Read the addition data of a cell, throw snapshot_error if the snapshot has no addition
+     * data plane of this type or the cell has no addition data
+     */
+    template <typename T>
+    [[nodiscard]] T get_addition_data(std::uint32_t pos_x, std::uint32_t pos_y) const
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable!");
+        if (!has_addition_plane() || header_.addition_size != sizeof(T) || header_.addition_tag != snapshot_addition_tag<T>)
+            throw snapshot_error("snapshot get_addition_data fails : no addition data plane of this type");
+        if (!has_addition_data(pos_x, pos_y))
+            throw snapshot_error("snapshot get_addition_data fails : no addition_data in " + std::to_string(pos_x) + " ," + std::to_string(pos_y));
+
+        T addition_data;
+        std::memcpy(&addition_data, data_ + detail::snapshot_layout(header_).addition_offset + (std::size_t(pos_y) * header_.width + pos_x) * sizeof(T), sizeof(T));
+        return addition_data;
+    }
+
+    // Raw bytes of the snapshot, starting with the header
+    [[nodiscard]] const char* data() const noexcept
+    {
+        return data_;
+    }
+
+private:
+    void validate()
+    {
+        if (size_ < sizeof(snapshot_header))
+            throw snapshot_error("snapshot is truncated");
+        std::memcpy(&header_, data_, sizeof(snapshot_header));
+
+        if (header_.magic != snapshot_header::snapshot_magic)
+            throw snapshot_error("snapshot has a bad magic");
+        if (header_.version != snapshot_header::current_version)
+            throw snapshot_error("snapshot version " + std::to_string(header_.version) + " is not supported");
+        if (((header_.flags & snapshot_header::is_big_endian) != 0) != (std::endian::native == std::endian::big))
+            throw snapshot_error("snapshot was written with another byte order");
+        const auto total_size = detail::snapshot_layout(header_).total_size;
+        if (total_size == SIZE_MAX)
+            throw snapshot_error("snapshot dimensions overflow");
+        if (total_size > size_)
+            throw snapshot_error("snapshot is truncated");
+    }
+
+    std::optional<mapped_file> file_;
+    const char* data_;
+    std::size_t size_;
+    snapshot_header header_;
+};
+
+// Number of bytes `write_snapshot` writes for the screen
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+[[nodiscard]] std::size_t get_snapshot_size(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>&) noexcept
+{
+    using screen_type = ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>;
+    return detail::snapshot_layout(detail::make_snapshot_header<screen_type>(width, height)).total_size;
+}
+
+// Write the snapshot of the screen to `buffer`, which must hold `get_snapshot_size(screen)` bytes
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+void write_snapshot(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, char* buffer) noexcept
+{
+    using screen_type = ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>;
+    using traits = detail::snapshot_traits<screen_type>;
+    constexpr std::size_t cell_count = std::size_t(width) * height;
+
+    const auto header = detail::make_snapshot_header<screen_type>(width, height);
+    const detail::snapshot_layout layout(header);
+    std::memset(buffer, 0, layout.total_size); // Padding between planes
+    std::memcpy(buffer, &header, sizeof(header));
+    std::memcpy(buffer + layout.char_offset, screen.data(), cell_count);
+    if constexpr (traits::has_attribute)
+        std::memcpy(buffer + layout.attribute_offset, screen.get_attribute_plane(), cell_count * sizeof(text_attribute));
+    if constexpr (traits::has_addition)
+        std::memcpy(buffer + layout.addition_offset, screen.get_addition_data_plane(), cell_count * traits::addition_size);
+    if constexpr (traits::has_presence)
+        std::memcpy(buffer + layout.presence_offset, screen.get_presence_bits(), (cell_count + 63) / 64 * sizeof(std::uint64_t));
+}
+
+// Append the snapshot of the screen to `buffer`
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+void save_snapshot(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::string& buffer)
+{
+    const std::size_t offset = buffer.size();
+    buffer.resize(offset + get_snapshot_size(screen));
+    write_snapshot(screen, buffer.data() + offset);
+}
+
+// Write the snapshot of the screen to a file through a writable mapping, the file is replaced
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+void save_snapshot(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, const std::filesystem::path& path)
+{
+    auto file = mapped_file::create(path, get_snapshot_size(screen));
+    write_snapshot(screen, file.data());
+}
+
+/**
+ * @brief Copy a snapshot into the screen, throw snapshot_error if the size or the addition data type (see
+ * snapshot_addition_tag) doesn't match. Planes that the snapshot doesn't carry are cleared, planes the screen
+ * doesn't have are ignored
+ */
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+void load_snapshot(ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, const snapshot_view& snapshot)
+{
+    using screen_type = ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>;
+    using traits = detail::snapshot_traits<screen_type>;
+    constexpr std::size_t cell_count = std::size_t(width) * height;
+
+    const auto& header = snapshot.header();
+    if (header.width != width || header.height != height)
+        throw snapshot_error("snapshot size " + std::to_string(header.width) + "x" + std::to_string(header.height) + " doesn't match the screen");
+    if (traits::has_addition && snapshot.has_addition_plane() && (header.addition_size != traits::addition_size || header.addition_tag != traits::addition_tag))
+        throw snapshot_error("snapshot holds another addition data type");
+
+    const bool is_attribute_loaded = traits::has_attribute && snapshot.has_attribute_plane();
+    const bool is_addition_loaded = traits::has_addition && snapshot.has_addition_plane()
+        && ((header.flags & snapshot_header::has_presence_plane) != 0) == traits::has_presence;
+    if ((is_add_attribute && !is_attribute_loaded) || (is_add_addition && !is_addition_loaded))
+        screen.clear();
+
+    const detail::snapshot_layout layout(header);
+    std::memcpy(screen.data(), snapshot.data() + layout.char_offset, cell_count);
+    if constexpr (traits::has_attribute)
+        if (is_attribute_loaded)
+            std::memcpy(screen.get_attribute_plane(), snapshot.data() + layout.attribute_offset, cell_count * sizeof(text_attribute));
+    if constexpr (traits::has_addition)
+        if (is_addition_loaded)
+            std::memcpy(screen.get_addition_data_plane(), snapshot.data() + layout.addition_offset, cell_count * traits::addition_size);
+    if constexpr (traits::has_presence)
+    {
+        if (is_addition_loaded)
+        {
+            auto* bits = screen.get_presence_bits();
+            std::memcpy(bits, snapshot.data() + layout.presence_offset, (cell_count + 63) / 64 * sizeof(std::uint64_t));
+            if constexpr (cell_count % 64 != 0)
+                bits[cell_count / 64] &= (std::uint64_t(1) << (cell_count % 64)) - 1;
+        }
+    }
+
+    if constexpr (is_track_dirty)
+        screen.mark_dirty();
+}
+
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+void load_snapshot(ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, const std::filesystem::path& path)
+{
+    load_snapshot(screen, snapshot_view(path));
+}
+
+/**
+ * @brief Encode a sequence of frames as delta frames, every frame only stores the spans of cells (chars and
+ * attributes) that changed since the previous one. The first frame after construction or `reset()` stores every cell
+ */
+template <std::uint32_t width, std::uint32_t height>
+class delta_encoder
+{
+public:
+    static constexpr std::size_t cell_count = std::size_t(width) * height;
+
+    // Unchanged cells between two changed spans that are still merged into one span, saves the 8 bytes span header
+    std::uint32_t merge_gap = 8;
+
+    delta_encoder() : last_chars_ptr_(std::make_unique<std::array<char, cell_count>>()) { }
+
+    // The next frame is encoded against an empty state, i.e. stores every cell
+    void reset() noexcept
+    {
+        has_last_frame_ = false;
+    }
+
+    // Append the delta frame of `screen` to `buffer`, return the number of spans
+    template <bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+    std::uint32_t encode(const ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, std::string& buffer)
+    {
+        const char* chars = screen.data();
+        const text_attribute* attributes = nullptr;
+        if constexpr (is_add_attribute)
+        {
+            attributes = screen.get_attribute_plane();
+            if (!last_attributes_ptr_)
+            {
+                last_attributes_ptr_ = std::make_unique<std::array<text_attribute, cell_count>>();
+                has_last_frame_ = false;
+            }
+        }
+
+        const std::size_t header_offset = buffer.size();
+        buffer.resize(header_offset + sizeof(delta_frame_header));
+        delta_frame_header header;
+        header.cell_count = static_cast<std::uint32_t>(cell_count);
+        if constexpr (is_add_attribute)
+            header.flags |= delta_frame_header::has_attribute_spans;
+
+        auto add_span = [&](std::uint32_t start, std::uint32_t end) {
+            const std::uint32_t span[2] = { start, end - start };
+            buffer.append(reinterpret_cast<const char*>(span), sizeof(span)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            buffer.append(chars + start, end - start);
+            if constexpr (is_add_attribute)
+                buffer.append(reinterpret_cast<const char*>(attributes + start), (end - start) * sizeof(text_attribute)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            ++header.span_count;
+        };
+
+        if (!has_last_frame_)
+        {
+            add_span(0, static_cast<std::uint32_t>(cell_count));
+        } else {
+            const char* last_chars = last_chars_ptr_->data();
+            if constexpr (is_add_attribute)
+            {
+                const text_attribute* last_attributes = last_attributes_ptr_->data();
+                detail::for_each_changed_span(
+                    static_cast<std::uint32_t>(cell_count), merge_gap, [&](std::uint32_t index) { return last_chars[index] != chars[index] || last_attributes[index] != attributes[index]; }, add_span);
+            } else {
+                detail::for_each_changed_span(last_chars, chars, static_cast<std::uint32_t>(cell_count), merge_gap, add_span);
+            }
+        }
+
+        std::memcpy(last_chars_ptr_->data(), chars, cell_count);
+        if constexpr (is_add_attribute)
+            std::memcpy(last_attributes_ptr_->data(), attributes, cell_count * sizeof(text_attribute));
+        has_last_frame_ = true;
+
+        header.payload_size = static_cast<std::uint32_t>(buffer.size() - header_offset - sizeof(delta_frame_header));
+        std::memcpy(buffer.data() + header_offset, &header, sizeof(header));
+        return header.span_count;
+    }
+
+private:
+    std::unique_ptr<std::array<char, cell_count>> last_chars_ptr_;
+    std::unique_ptr<std::array<text_attribute, cell_count>> last_attributes_ptr_;
+    bool has_last_frame_ = false;
+};
+
+/**
+ * @brief Apply one delta frame from `data` to the screen, return the number of bytes consumed.
+ * Throw snapshot_error if the frame is malformed or was recorded from a screen of another size.
+ * Attribute spans are skipped when the screen has no attribute plane
+ */
+template <std::uint32_t width, std::uint32_t height, bool is_add_addition, bool is_track_dirty, typename AdditionStorage, bool is_add_attribute>
+std::size_t apply_delta(ascii_screen<width, height, is_add_addition, is_track_dirty, AdditionStorage, is_add_attribute>& screen, const char* data, std::size_t size)
+{
+    constexpr std::size_t cell_count = std::size_t(width) * height;
+
+    delta_frame_header header;
+    if (size < sizeof(header))
+        throw snapshot_error("delta frame is truncated");
+    std::memcpy(&header, data, sizeof(header));
+    if (header.cell_count != cell_count)
+        throw snapshot_error("delta frame doesn't match the screen size");
+    if (size - sizeof(header) < header.payload_size)
+        throw snapshot_error("delta frame is truncated");
+
+    const bool has_attribute_spans = (header.flags & delta_frame_header::has_attribute_spans) != 0;
+    const std::size_t cell_size = 1 + (has_attribute_spans ? sizeof(text_attribute) : 0);
+    const char* current = data + sizeof(header);
+    const char* end = current + header.payload_size;
+    for (std::uint32_t span_index = 0; span_index < header.span_count; ++span_index)
+    {
+        std::uint32_t span[2];
+        if (std::size_t(end - current) < sizeof(span))
+            throw snapshot_error("delta frame is truncated");
+        std::memcpy(span, current, sizeof(span));
+        current += sizeof(span);
+
+        const auto [start, count] = span;
+        if (std::size_t(start) + count > cell_count || std::size_t(end - current) < count * cell_size)
+            throw snapshot_error("delta frame has a bad span");
+
+        std::memcpy(screen.data() + start, current, count);
+        current += count;
+        if (has_attribute_spans)
+        {
+            if constexpr (is_add_attribute)
+                std::memcpy(screen.get_attribute_plane() + start, current, count * sizeof(text_attribute));
+            current += count * sizeof(text_attribute);
+        }
+
+        if constexpr (is_track_dirty)
+            detail::for_each_row_piece(width, start, count, [&](std::uint32_t row, std::uint32_t first, std::uint32_t last) { screen.mark_dirty_row(row, first, last); });
+    }
+
+    return sizeof(header) + header.payload_size;
+}
+
+} // namespace lot
\ No newline at end of file
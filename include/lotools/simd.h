@@ -0,0 +1,18 @@
+#pragma once
+
+// The SIMD kernels are selected at compile time from the target flags (e.g. -mavx2 or /arch:AVX2),
+// define LOT_NO_SIMD to always use the scalar fallback
+#if !defined(LOT_NO_SIMD)
+#    if defined(__AVX2__)
+#        define LOT_SIMD_AVX2 // NOLINT(cppcoreguidelines-macro-usage)
+#    endif
+#    if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#        define LOT_SIMD_SSE2 // NOLINT(cppcoreguidelines-macro-usage)
+#    endif
+#endif
+
+#if defined(LOT_SIMD_AVX2)
+#    include <immintrin.h>
+#elif defined(LOT_SIMD_SSE2)
+#    include <emmintrin.h>
+#endif
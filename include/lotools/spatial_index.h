@@ -0,0 +1,531 @@
+#pragma once
+
+#include "base.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lot {
+
+namespace detail {
+
+    template <typename T>
+    using spatial_distance_t = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+    template <typename T, std::size_t dimension>
+    [[nodiscard]] constexpr spatial_distance_t<T> distance_squared(const coordinate<T, dimension>& lhs, const coordinate<T, dimension>& rhs) noexcept
+    {
+        spatial_distance_t<T> result = 0;
+        for (std::size_t axis = 0; axis < dimension; ++axis)
+        {
+            const auto diff = static_cast<spatial_distance_t<T>>(lhs.data[axis]) - static_cast<spatial_distance_t<T>>(rhs.data[axis]);
+            result += diff * diff;
+        }
+        return result;
+    }
+
+    template <typename T, std::size_t dimension>
+    [[nodiscard]] constexpr bool is_in_box(const coordinate<T, dimension>& position, const coordinate<T, dimension>& box_min, const coordinate<T, dimension>& box_max) noexcept
+    {
+        for (std::size_t axis = 0; axis < dimension; ++axis)
+            if (position.data[axis] < box_min.data[axis] || position.data[axis] > box_max.data[axis])
+                return false;
+        return true;
+    }
+
+} // namespace detail
+
+/**
+ * @brief A uniform hash grid for sets that change every tick: only the cells that hold entries are stored, and
+ * insert, move and remove are O(1). A query visits the cells overlapping its range, so pick a cell size close to
+ * the usual query radius
+ *
+ * @tparam Id Key of an entry, hashed with std::hash
+ */
+template <typename T, std::size_t dimension, typename Id = std::uint32_t>
+class uniform_grid
+{
+public:
+    using value_type = coordinate<T, dimension>;
+    using distance_type = detail::spatial_distance_t<T>;
+    using cell_type = std::array<std::int64_t, dimension>;
+
+    explicit uniform_grid(distance_type cell_size) : cell_size_(cell_size)
+    {
+        lo_assert(cell_size > 0);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return entry_list_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return entry_list_.empty();
+    }
+
+    [[nodiscard]] bool contains(const Id& id) const
+    {
+        return entry_map_.contains(id);
+    }
+
+    // Room for `count` entries, the cells are created as entries land in them
+    void reserve(std::size_t count)
+    {
+        lo_assert(count <= (std::numeric_limits<std::uint32_t>::max)());
+        entry_list_.reserve(count);
+        entry_map_.reserve(count);
+    }
+
+    /**
+     * @brief Replace the entries by `entry_list`, every id at most once. The cells of large lists are computed over up
+     * to `thread_count` threads, then the entries are linked into their cells in order on the current thread, so the
+     * result is the same as inserting them one by one
+     */
+    void build(std::span<const std::pair<Id, value_type>> entry_list, std::size_t thread_count = std::thread::hardware_concurrency())
+    {
+        lo_assert(entry_list.size() <= (std::numeric_limits<std::uint32_t>::max)());
+        clear();
+        reserve(entry_list.size());
+
+        std::vector<cell_type> cell_list(entry_list.size());
+        auto bin_range = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t index = begin; index < end; ++index)
+                cell_list[index] = get_cell(entry_list[index].second);
+        };
+        const std::size_t chunk_count = std::clamp<std::size_t>(entry_list.size() / parallel_threshold, 1, std::max<std::size_t>(thread_count, 1));
+        const std::size_t chunk_size = (entry_list.size() + chunk_count - 1) / chunk_count;
+        {
+            std::vector<std::jthread> thread_list;
+            thread_list.reserve(chunk_count - 1);
+            for (std::size_t begin = chunk_size; begin < entry_list.size(); begin += chunk_size)
+                thread_list.emplace_back(bin_range, begin, (std::min)(begin + chunk_size, entry_list.size()));
+            bin_range(0, (std::min)(chunk_size, entry_list.size()));
+        }
+
+        for (std::size_t index = 0; index < entry_list.size(); ++index)
+        {
+            const auto& [id, position] = entry_list[index];
+            const auto entry_index = static_cast<std::uint32_t>(index);
+            auto& cell_entry_list = cell_map_[cell_list[index]];
+            entry_list_.push_back({ id, position, cell_list[index], static_cast<std::uint32_t>(cell_entry_list.size()) });
+            cell_entry_list.push_back(entry_index);
+            [[maybe_unused]] const bool is_inserted = entry_map_.emplace(id, entry_index).second;
+            lo_assert(is_inserted);
+        }
+    }
+
+    // The id must not be in the grid
+    void insert(const Id& id, const value_type& position)
+    {
+        lo_assert(!contains(id));
+        lo_assert(entry_list_.size() < (std::numeric_limits<std::uint32_t>::max)());
+        const auto entry_index = static_cast<std::uint32_t>(entry_list_.size());
+        const auto cell = get_cell(position);
+        auto& cell_entry_list = cell_map_[cell];
+        entry_list_.push_back({ id, position, cell, static_cast<std::uint32_t>(cell_entry_list.size()) });
+        cell_entry_list.push_back(entry_index);
+        entry_map_.emplace(id, entry_index);
+    }
+
+    // The id must be in the grid
+    void move(const Id& id, const value_type& position)
+    {
+        const auto iter = entry_map_.find(id);
+        lo_assert(iter != entry_map_.end());
+        auto& entry = entry_list_[iter->second];
+        entry.position = position;
+
+        const auto cell = get_cell(position);
+        if (cell == entry.cell)
+            return;
+
+        unlink_cell(iter->second);
+        auto& cell_entry_list = cell_map_[cell];
+        entry.cell = cell;
+        entry.cell_slot = static_cast<std::uint32_t>(cell_entry_list.size());
+        cell_entry_list.push_back(iter->second);
+    }
+
+    // Return false if the id isn't in the grid
+    bool remove(const Id& id)
+    {
+        const auto iter = entry_map_.find(id);
+        if (iter == entry_map_.end())
+            return false;
+
+        const auto entry_index = iter->second;
+        unlink_cell(entry_index);
+        entry_map_.erase(iter);
+
+        // Fill the hole with the last entry
+        const auto last_index = static_cast<std::uint32_t>(entry_list_.size() - 1);
+        if (entry_index != last_index)
+        {
+            auto& last = entry_list_[last_index];
+            cell_map_.find(last.cell)->second[last.cell_slot] = entry_index;
+            entry_map_.find(last.id)->second = entry_index;
+            entry_list_[entry_index] = std::move(last);
+        }
+        entry_list_.pop_back();
+        return true;
+    }
+
+    [[nodiscard]] const value_type& get_position(const Id& id) const
+    {
+        const auto iter = entry_map_.find(id);
+        lo_assert(iter != entry_map_.end());
+        return entry_list_[iter->second].position;
+    }
+
+    void clear() noexcept
+    {
+        entry_list_.clear();
+        entry_map_.clear();
+        cell_map_.clear();
+    }
+
+    // Call `func(const Id&, const value_type&)` for every entry within `radius` of `center`
+    template <typename Func>
+    void for_each_in_radius(const value_type& center, distance_type radius, Func&& func) const
+    {
+        const distance_type radius_squared = radius * radius;
+        for_each_cell_entry(get_cell(center, -radius), get_cell(center, radius), [&](const auto& entry) {
+            if (detail::distance_squared(entry.position, center) <= radius_squared)
+                func(entry.id, entry.position);
+        });
+    }
+
+    // Call `func(const Id&, const value_type&)` for every entry inside the box, bounds included
+    template <typename Func>
+    void for_each_in_box(const value_type& box_min, const value_type& box_max, Func&& func) const
+    {
+        for_each_cell_entry(get_cell(box_min), get_cell(box_max), [&](const auto& entry) {
+            if (detail::is_in_box(entry.position, box_min, box_max))
+                func(entry.id, entry.position);
+        });
+    }
+
+private:
+    // Lists shorter than this are binned on the current thread
+    static constexpr std::size_t parallel_threshold = 16384;
+
+    struct entry_type
+    {
+        Id id;
+        value_type position;
+        cell_type cell;
+        std::uint32_t cell_slot; // Index in the entry list of the cell
+    };
+
+    struct cell_hash
+    {
+        [[nodiscard]] std::size_t operator()(const cell_type& cell) const noexcept
+        {
+            std::uint64_t result = 0xcbf29ce484222325ULL;
+            for (auto value : cell)
+                result = (result ^ static_cast<std::uint64_t>(value)) * 0x100000001b3ULL;
+            return static_cast<std::size_t>(result ^ (result >> 32));
+        }
+    };
+
+    [[nodiscard]] cell_type get_cell(const value_type& position, distance_type offset = 0) const noexcept
+    {
+        cell_type cell {};
+        for (std::size_t axis = 0; axis < dimension; ++axis)
+            cell[axis] = static_cast<std::int64_t>(std::floor((static_cast<distance_type>(position.data[axis]) + offset) / cell_size_));
+        return cell;
+    }
+
+    // Remove the entry from its cell, the last entry of the cell takes its slot
+    void unlink_cell(std::uint32_t entry_index)
+    {
+        const auto& entry = entry_list_[entry_index];
+        const auto cell_iter = cell_map_.find(entry.cell);
+        auto& cell_entry_list = cell_iter->second;
+        const auto moved_index = cell_entry_list.back();
+        cell_entry_list[entry.cell_slot] = moved_index;
+        entry_list_[moved_index].cell_slot = entry.cell_slot;
+        cell_entry_list.pop_back();
+        if (cell_entry_list.empty())
+            cell_map_.erase(cell_iter);
+    }
+
+    // Visit the entries of every stored cell in [first, last]
+    template <typename Func>
+    void for_each_cell_entry(const cell_type& first, const cell_type& last, Func&& func) const
+    {
+        // Fewer stored cells than cells in the range, scanning the map is cheaper
+        constexpr std::uint64_t max_range_count = (std::numeric_limits<std::uint32_t>::max)();
+        std::uint64_t range_count = 1;
+        for (std::size_t axis = 0; axis < dimension; ++axis)
+        {
+            const auto axis_count = static_cast<std::uint64_t>(last[axis] - first[axis]) + 1;
+            range_count = axis_count > max_range_count / range_count ? max_range_count : range_count * axis_count;
+        }
+        if (range_count > cell_map_.size())
+        {
+            for (const auto& [cell, cell_entry_list] : cell_map_)
+            {
+                bool is_inside = true;
+                for (std::size_t axis = 0; axis < dimension; ++axis)
+                    is_inside = is_inside && cell[axis] >= first[axis] && cell[axis] <= last[axis];
+                if (is_inside)
+                    for (auto entry_index : cell_entry_list)
+                        func(entry_list_[entry_index]);
+            }
+            return;
+        }
+
+        cell_type cell = first;
+        while (true)
+        {
+            if (auto iter = cell_map_.find(cell); iter != cell_map_.end())
+                for (auto entry_index : iter->second)
+                    func(entry_list_[entry_index]);
+
+            std::size_t axis = 0;
+            for (; axis < dimension; ++axis)
+            {
+                if (cell[axis] < last[axis])
+                {
+                    ++cell[axis];
+                    break;
+                }
+                cell[axis] = first[axis];
+            }
+            if (axis == dimension)
+                return;
+        }
+    }
+
+    distance_type cell_size_;
+    std::vector<entry_type> entry_list_;
+    std::unordered_map<Id, std::uint32_t> entry_map_;
+    std::unordered_map<cell_type, std::vector<std::uint32_t>, cell_hash> cell_map_;
+};
+
+/**
+ * @brief A static k-d tree for sets that are read far more often than they change, rebuild it to change the set.
+ * The tree is implicit: the points are reordered so every range is split at its median, no node is stored.
+ * Queries report the index of the point in the span the tree was built from
+ */
+template <typename T, std::size_t dimension>
+class kd_tree
+{
+public:
+    using value_type = coordinate<T, dimension>;
+    using distance_type = detail::spatial_distance_t<T>;
+
+    kd_tree() = default;
+
+    // Build from `point_list`, splitting large subtrees over up to `thread_count` threads
+    explicit kd_tree(std::span<const value_type> point_list, std::size_t thread_count = std::thread::hardware_concurrency())
+    {
+        build(point_list, thread_count);
+    }
+
+    void build(std::span<const value_type> point_list, std::size_t thread_count = std::thread::hardware_concurrency())
+    {
+        lo_assert(point_list.size() <= (std::numeric_limits<std::uint32_t>::max)());
+        entry_list_.resize(point_list.size());
+        for (std::size_t index = 0; index < point_list.size(); ++index)
+            entry_list_[index] = { point_list[index], static_cast<std::uint32_t>(index) };
+        build_range(0, entry_list_.size(), 0, std::max<std::size_t>(thread_count, 1));
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return entry_list_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return entry_list_.empty();
+    }
+
+    // Call `func(std::uint32_t index, const value_type&)` for every point within `radius` of `center`
+    template <typename Func>
+    void for_each_in_radius(const value_type& center, distance_type radius, Func&& func) const
+    {
+        radius_query(0, entry_list_.size(), 0, center, radius * radius, func);
+    }
+
+    // Call `func(std::uint32_t index, const value_type&)` for every point inside the box, bounds included
+    template <typename Func>
+    void for_each_in_box(const value_type& box_min, const value_type& box_max, Func&& func) const
+    {
+        box_query(0, entry_list_.size(), 0, box_min, box_max, func);
+    }
+
+    /**
+     * @brief Find the `count` points nearest to `center`
+     *
+     * @param result Cleared, then receives the indexes, nearest first
+     */
+    void nearest(const value_type& center, std::size_t count, std::vector<std::uint32_t>& result) const
+    {
+        result.clear();
+        if (count == 0)
+            return;
+
+        std::vector<std::pair<distance_type, std::uint32_t>> heap; // Max heap of the best candidates
+        heap.reserve((std::min)(count, entry_list_.size()) + 1);
+        nearest_query(0, entry_list_.size(), 0, center, count, heap);
+
+        std::sort_heap(heap.begin(), heap.end());
+        result.reserve(heap.size());
+        for (const auto& candidate : heap)
+            result.push_back(candidate.second);
+    }
+
+    // Return the index of the point nearest to `center`, size() if the tree is empty
+    [[nodiscard]] std::size_t nearest(const value_type& center) const
+    {
+        std::vector<std::pair<distance_type, std::uint32_t>> heap;
+        heap.reserve(2);
+        nearest_query(0, entry_list_.size(), 0, center, 1, heap);
+        return heap.empty() ? entry_list_.size() : heap.front().second;
+    }
+
+private:
+    struct entry_type
+    {
+        value_type position;
+        std::uint32_t index;
+    };
+
+    // Ranges up to this size are scanned instead of split
+    static constexpr std::size_t leaf_size = 8;
+    // Subtrees smaller than this are built on the current thread
+    static constexpr std::size_t parallel_threshold = 16384;
+
+    void build_range(std::size_t begin, std::size_t end, std::size_t axis, std::size_t thread_count)
+    {
+        if (end - begin <= leaf_size)
+            return;
+
+        const std::size_t middle = begin + (end - begin) / 2;
+        std::nth_element(entry_list_.begin() + static_cast<std::ptrdiff_t>(begin), entry_list_.begin() + static_cast<std::ptrdiff_t>(middle),
+            entry_list_.begin() + static_cast<std::ptrdiff_t>(end), [axis](const entry_type& lhs, const entry_type& rhs) { return lhs.position.data[axis] < rhs.position.data[axis]; });
+
+        const std::size_t next_axis = (axis + 1) % dimension;
+        if (thread_count > 1 && end - begin >= parallel_threshold)
+        {
+            const std::size_t left_thread_count = thread_count / 2;
+            std::jthread left_thread([this, begin, middle, next_axis, left_thread_count] { build_range(begin, middle, next_axis, left_thread_count); });
+            build_range(middle + 1, end, next_axis, thread_count - left_thread_count);
+            return;
+        }
+        build_range(begin, middle, next_axis, 1);
+        build_range(middle + 1, end, next_axis, 1);
+    }
+
+    template <typename Func>
+    void radius_query(std::size_t begin, std::size_t end, std::size_t axis, const value_type& center, distance_type radius_squared, Func& func) const
+    {
+        if (end - begin <= leaf_size)
+        {
+            for (std::size_t index = begin; index < end; ++index)
+                if (detail::distance_squared(entry_list_[index].position, center) <= radius_squared)
+                    func(entry_list_[index].index, entry_list_[index].position);
+            return;
+        }
+
+        const std::size_t middle = begin + (end - begin) / 2;
+        const auto& split = entry_list_[middle];
+        if (detail::distance_squared(split.position, center) <= radius_squared)
+            func(split.index, split.position);
+
+        const auto diff = static_cast<distance_type>(center.data[axis]) - static_cast<distance_type>(split.position.data[axis]);
+        const std::size_t next_axis = (axis + 1) % dimension;
+        if (diff <= 0 || diff * diff <= radius_squared)
+            radius_query(begin, middle, next_axis, center, radius_squared, func);
+        if (diff >= 0 || diff * diff <= radius_squared)
+            radius_query(middle + 1, end, next_axis, center, radius_squared, func);
+    }
+
+    template <typename Func>
+    void box_query(std::size_t begin, std::size_t end, std::size_t axis, const value_type& box_min, const value_type& box_max, Func& func) const
+    {
+        if (end - begin <= leaf_size)
+        {
+            for (std::size_t index = begin; index < end; ++index)
+                if (detail::is_in_box(entry_list_[index].position, box_min, box_max))
+                    func(entry_list_[index].index, entry_list_[index].position);
+            return;
+        }
+
+        const std::size_t middle = begin + (end - begin) / 2;
+        const auto& split = entry_list_[middle];
+        if (detail::is_in_box(split.position, box_min, box_max))
+            func(split.index, split.position);
+
+        const std::size_t next_axis = (axis + 1) % dimension;
+        if (box_min.data[axis] <= split.position.data[axis])
+            box_query(begin, middle, next_axis, box_min, box_max, func);
+        if (box_max.data[axis] >= split.position.data[axis])
+            box_query(middle + 1, end, next_axis, box_min, box_max, func);
+    }
+
+    void nearest_query(std::size_t begin, std::size_t end, std::size_t axis, const value_type& center, std::size_t count,
+        std::vector<std::pair<distance_type, std::uint32_t>>& heap) const
+    {
+        auto offer = [&](const entry_type& entry) {
+            const auto distance = detail::distance_squared(entry.position, center);
+            if (heap.size() < count)
+            {
+                heap.emplace_back(distance, entry.index);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (distance < heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = { distance, entry.index };
+                std::push_heap(heap.begin(), heap.end());
+            }
+        };
+
+        if (end - begin <= leaf_size)
+        {
+            for (std::size_t index = begin; index < end; ++index)
+                offer(entry_list_[index]);
+            return;
+        }
+
+        const std::size_t middle = begin + (end - begin) / 2;
+        const auto& split = entry_list_[middle];
+        offer(split);
+
+        // Search the side of the center first, the other side only if it can still hold a closer point
+        const auto diff = static_cast<distance_type>(center.data[axis]) - static_cast<distance_type>(split.position.data[axis]);
+        const std::size_t next_axis = (axis + 1) % dimension;
+        const bool is_left_first = diff <= 0;
+        if (is_left_first)
+            nearest_query(begin, middle, next_axis, center, count, heap);
+        else
+            nearest_query(middle + 1, end, next_axis, center, count, heap);
+
+        if (heap.size() < count || diff * diff < heap.front().first)
+        {
+            if (is_left_first)
+                nearest_query(middle + 1, end, next_axis, center, count, heap);
+            else
+                nearest_query(begin, middle, next_axis, center, count, heap);
+        }
+    }
+
+    std::vector<entry_type> entry_list_;
+};
+
+} // namespace lot
@@ -0,0 +1,130 @@
+#include "lotools/ascii_screen.h"
+#include "lotools/coordinate.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+// Micro benchmarks of the hot paths, run `lotools_bench [iterations]`. Every number is the best of 5 runs in
+// nanoseconds per iteration, output goes to the null device so only the formatting and the syscalls are measured
+
+namespace {
+
+    std::size_t iteration_count = 2000;
+
+#ifdef _WIN32
+    constexpr const char* null_device = "NUL";
+#else
+    constexpr const char* null_device = "/dev/null";
+#endif
+
+    template <typename Func>
+    double measure(Func&& func)
+    {
+        double best = 0;
+        for (int run = 0; run < 5; ++run)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            for (std::size_t index = 0; index < iteration_count; ++index)
+                func();
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+            const double per_iteration = elapsed.count() / static_cast<double>(iteration_count);
+            best = run == 0 ? per_iteration : std::min(best, per_iteration);
+        }
+        return best;
+    }
+
+    // show(std::ostream&) buffered and unbuffered against show(fd) and show(std::string&) plus one write
+    template <std::uint32_t width, std::uint32_t height>
+    void bench_screen_output()
+    {
+        lot::ascii_screen<width, height> screen;
+        for (std::uint32_t pos_y = 0; pos_y < height; ++pos_y)
+            for (std::uint32_t pos_x = 0; pos_x < width; ++pos_x)
+                screen.set(pos_x, pos_y, static_cast<char>('!' + (pos_x + pos_y) % 90));
+
+        std::ofstream buffered(null_device);
+        std::ofstream unbuffered;
+        unbuffered.rdbuf()->pubsetbuf(nullptr, 0);
+        unbuffered.open(null_device);
+
+        const double buffered_time = measure([&] { screen.show(buffered); });
+        const double unbuffered_time = measure([&] { screen.show(unbuffered); });
+        std::printf("screen %ux%u  ostream %.0f ns  unbuffered ostream %.0f ns", width, height, buffered_time, unbuffered_time);
+
+#ifndef _WIN32
+        const int file_descriptor = ::open(null_device, O_WRONLY | O_CLOEXEC);
+        if (file_descriptor < 0)
+        {
+            std::printf("\n");
+            return;
+        }
+
+        std::string frame_buffer;
+        const double writev_time = measure([&] { screen.show(file_descriptor); });
+        const double buffer_time = measure([&] {
+            frame_buffer.clear();
+            screen.show(frame_buffer);
+            [[maybe_unused]] const auto written = ::write(file_descriptor, frame_buffer.data(), frame_buffer.size());
+        });
+        ::close(file_descriptor);
+        std::printf("  show(fd) %.0f ns  show(buffer) + write %.0f ns", writev_time, buffer_time);
+#endif
+        std::printf("\n");
+    }
+
+    // parse_coordinate_list (from_chars) against a loop of operator>> over an istringstream, per coordinate
+    template <typename T>
+    void bench_coordinate_parse(const char* type_name)
+    {
+        constexpr std::size_t coordinate_count = 1000;
+        std::string text;
+        for (std::size_t index = 0; index < coordinate_count; ++index)
+        {
+            const lot::point<T> value { static_cast<T>(index * 37 % 1000) / static_cast<T>(8), static_cast<T>(index % 113) - static_cast<T>(50) };
+            text += value.to_string();
+            text += index % 8 == 7 ? '\n' : ' ';
+        }
+
+        std::vector<lot::point<T>> result;
+        result.reserve(coordinate_count);
+        const double list_time = measure([&] {
+            result.clear();
+            lot::parse_coordinate_list(text, result);
+        });
+        const double stream_time = measure([&] {
+            result.clear();
+            std::istringstream in(text);
+            lot::point<T> value {};
+            while (in >> std::ws && !in.eof() && in >> value)
+                result.push_back(value);
+        });
+        std::printf("parse %zu points of %s  parse_coordinate_list %.1f ns  istream %.1f ns  per coordinate\n", coordinate_count, type_name,
+            list_time / coordinate_count, stream_time / coordinate_count);
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        iteration_count = std::max<std::size_t>(1, std::strtoull(argv[1], nullptr, 10));
+
+    bench_screen_output<80, 24>();
+    bench_screen_output<160, 48>();
+    bench_screen_output<400, 120>();
+    bench_coordinate_parse<int>("int");
+    bench_coordinate_parse<double>("double");
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,620 @@
+#include "lotools/ascii_screen.h"
+#include "lotools/cmdcomplete.h"
+#include "lotools/cmdparser.h"
+#include "lotools/coordinate.h"
+#include "lotools/coordinate_codec.h"
+#include "lotools/coordinate_soa.h"
+#include "lotools/screen_snapshot.h"
+#include "lotools/spatial_index.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Count the global heap allocations made while `is_count_allocation` is set
+namespace {
+    std::size_t allocation_count = 0;
+    bool is_count_allocation = false;
+}
+
+void* operator new(std::size_t size)
+{
+    if (is_count_allocation)
+        ++allocation_count;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t /*size*/) noexcept
+{
+    std::free(pointer);
+}
+
+namespace {
+
+    int failure_count = 0;
+
+    void check(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", message);
+            ++failure_count;
+        }
+    }
+
+    int run_result = 0;
+
+    void run_command(const lot::cmdparser& args)
+    {
+        run_result = args.get<int>("--jobs") + static_cast<int>(args.get_value_list().size());
+    }
+
+    struct copy_options
+    {
+        int jobs = 1;
+        bool is_force = false;
+
+        static constexpr auto options = std::tuple {
+            lot::option<&copy_options::jobs> { "--jobs", "Number of jobs" },
+            lot::option<&copy_options::is_force> { "--force", "Overwrite existing files" },
+        };
+    };
+
+    void copy_command(const copy_options& options, const lot::cmdparser& /*args*/)
+    {
+        run_result = options.jobs + (options.is_force ? 100 : 0);
+    }
+
+    using command_table = lot::static_command_table<lot::static_schema_command<"copy", copy_options, copy_command>>;
+
+    // parse() + exec() of a registered command with a monotonic arena over null_memory_resource don't touch the heap
+    void test_dynamic_command_allocation()
+    {
+        const char* argv[] = { "prog", "run", "--jobs=5", "first", "second", "key=1" };
+        std::array<std::byte, 4096> buffer {};
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+        lot::cmdparser parser(static_cast<int>(std::size(argv)), const_cast<char**>(argv), &arena); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        parser.add<run_command>("run");
+
+        allocation_count = 0;
+        is_count_allocation = true;
+        parser.parse();
+        parser.exec();
+        is_count_allocation = false;
+
+        check(allocation_count == 0, "dynamic command: parse + exec allocated on the heap");
+        check(run_result == 7, "dynamic command: wrong result");
+    }
+
+    // The static command table and the option schema don't touch the heap either
+    void test_static_schema_command_allocation()
+    {
+        const char* argv[] = { "prog", "copy", "--jobs=3", "--force" };
+        std::array<std::byte, 4096> buffer {};
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+        lot::cmdparser parser(static_cast<int>(std::size(argv)), const_cast<char**>(argv), &arena); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+
+        allocation_count = 0;
+        is_count_allocation = true;
+        parser.parse();
+        parser.exec<command_table>();
+        is_count_allocation = false;
+
+        check(allocation_count == 0, "static schema command: parse + exec allocated on the heap");
+        check(run_result == 103, "static schema command: wrong result");
+    }
+
+
+    // A tracking screen is compared by its dirty region only, a clear_dirty by someone else must not hide changes
+    void test_incremental_renderer_dirty_region()
+    {
+        lot::ascii_screen<20, 4, false, true> screen;
+        lot::incremental_renderer<20, 4> renderer;
+        std::ostringstream out;
+        renderer.render(screen, out);
+        check(!screen.is_dirty(), "incremental_renderer: the render didn't clear the dirty region");
+
+        out.str({});
+        screen.set(3, 1, 'a');
+        renderer.render(screen, out);
+        check(out.str() == "\033[2;4Ha", "incremental_renderer: wrong output for one changed cell");
+
+        out.str({});
+        screen.set(5, 2, 'b');
+        screen.clear_dirty();
+        renderer.render(screen, out);
+        check(out.str() == "\033[3;6Hb", "incremental_renderer: a foreign clear_dirty hid a change");
+
+        // A const screen is compared as a whole and keeps its dirty region
+        out.str({});
+        screen.set(0, 0, 'c');
+        const auto& const_screen = screen;
+        renderer.render(const_screen, out);
+        check(out.str() == "\033[1;1Hc" && screen.is_dirty(), "incremental_renderer: wrong output for a const screen");
+    }
+
+
+    template <typename Func>
+    bool throws_snapshot_error(Func&& func)
+    {
+        try {
+            func();
+        } catch (const lot::snapshot_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    // The addition plane is only loaded into a screen whose addition type has the same tag, not just the same size
+    void test_snapshot_addition_type()
+    {
+        lot::ascii_screen<8, 2, true, false, lot::dense_addition<std::int32_t>> int_screen;
+        int_screen.set(1, 1, 'x', 42);
+        std::string buffer;
+        lot::save_snapshot(int_screen, buffer);
+
+        lot::ascii_screen<8, 2, true, false, lot::dense_addition<std::int32_t>> int_copy;
+        lot::load_snapshot(int_copy, lot::snapshot_view(buffer.data(), buffer.size()));
+        check(int_copy.get(1, 1) == 'x' && int_copy.get_addition_data(1, 1) == 42, "snapshot: round trip of an int32_t addition plane");
+
+        lot::ascii_screen<8, 2, true, false, lot::dense_addition<float>> float_screen;
+        check(throws_snapshot_error([&] { lot::load_snapshot(float_screen, lot::snapshot_view(buffer.data(), buffer.size())); }),
+            "snapshot: an int32_t addition plane was loaded into a float screen");
+
+        const lot::snapshot_view view(buffer.data(), buffer.size());
+        check(view.get_addition_data<std::int32_t>(1, 1) == 42, "snapshot: get_addition_data of the stored type");
+        check(throws_snapshot_error([&] { (void)view.get_addition_data<std::uint32_t>(1, 1); }), "snapshot: get_addition_data with another type of the same size");
+    }
+
+    // A crafted header whose planes overflow std::size_t is rejected instead of passing the size check
+    void test_snapshot_overflow()
+    {
+        lot::snapshot_header header;
+        header.flags = lot::snapshot_header::has_attribute_plane | lot::snapshot_header::has_addition_plane;
+        if constexpr (std::endian::native == std::endian::big)
+            header.flags |= lot::snapshot_header::is_big_endian;
+        header.width = UINT32_MAX;
+        header.height = UINT32_MAX;
+        header.addition_size = UINT32_MAX;
+        std::array<char, 256> buffer {};
+        std::memcpy(buffer.data(), &header, sizeof(header));
+        check(throws_snapshot_error([&] { lot::snapshot_view(buffer.data(), buffer.size()); }), "snapshot: an overflowing header was accepted");
+    }
+
+
+    // A shared registry can't be changed by add, parsers built on it dispatch to its commands
+    void test_shared_registry()
+    {
+        const std::array<std::string_view, 3> args { "run", "--jobs=2", "first" };
+        lot::cmdparser registry(std::span<const std::string_view> {});
+        registry.add<run_command>("run");
+
+        std::optional<lot::cmdparser> worker(std::in_place, registry.shared_registry());
+        bool is_add_rejected = false;
+        try {
+            registry.add<run_command>("other");
+        } catch (const std::logic_error&) {
+            is_add_rejected = true;
+        }
+        check(is_add_rejected, "shared registry: add while the registry is shared");
+
+        run_result = 0;
+        worker->reset(args).parse();
+        worker->exec();
+        check(run_result == 3, "shared registry: a worker parser didn't dispatch to the registered command");
+
+        worker.reset();
+        registry.add<run_command>("other");
+        check(registry.shared_registry()->contains("other"), "shared registry: add after the last worker is gone");
+    }
+
+
+    // The candidates go to the output handler of the completion command
+    void test_completion_output()
+    {
+        std::string output;
+        const std::array<std::string_view, 2> args { "__complete", "r" };
+        lot::cmdparser parser(args);
+        parser.add<run_command>("run");
+        parser.add<run_command>("remove");
+        parser.add(std::make_unique<lot::completion_command>([&](std::string_view text, const lot::cmdparser& /*args*/) { output += text; }));
+        parser.parse();
+        parser.exec();
+        check(output == "remove\nrun\n", "completion: wrong candidates");
+    }
+
+
+    // Response files and value streams are read through the loader the program passes in
+    void test_argument_file_loader()
+    {
+        const std::array<std::string_view, 3> args { "run", "@options", "@@values" };
+        const auto loader = [](std::string_view path) -> lot::argument_file {
+            if (path == "options")
+                return { nullptr, "--jobs=4 \"first value\"" };
+            return { nullptr, "a b\nc" };
+        };
+        lot::cmdparser parser(args);
+        parser.add<run_command>("run");
+        parser.expand_response_files(loader).expand_value_streams(loader).parse();
+        std::string values;
+        parser.for_each_value([&](std::string_view value) { values += value; values += ';'; });
+        check(parser.get<int>("--jobs") == 4 && values == "first value;a;b;c;", "argument files: wrong arguments");
+    }
+
+
+    bool is_sub_fast = false;
+    bool is_sub_verbose = false;
+    bool is_root_verbose = false;
+
+    void sub_command(const lot::cmdparser& args)
+    {
+        is_sub_fast = args.has_option("--fast");
+        is_sub_verbose = args.has_option("--verbose");
+        is_root_verbose = args.get<bool>(0, "--verbose", false) && !args.has_option(0, "--fast");
+    }
+
+    // get and has_option only see the arguments of the performed command, the level overloads see one level each
+    void test_option_scope()
+    {
+        const std::array<std::string_view, 4> args { "db", "--verbose", "compact", "--fast" };
+        lot::cmdparser parser(args);
+        parser.add_group("db").add<sub_command>("compact");
+        parser.parse();
+        parser.exec();
+        check(is_sub_fast && !is_sub_verbose, "option scope: the subcommand saw an option of its group");
+        check(is_root_verbose, "option scope: the options of the group level");
+        check(parser.get_all<bool>(1, "--fast").size() == 1 && parser.get_all<bool>(0, "--fast").empty(), "option scope: get_all by level");
+    }
+
+
+    bool is_near(float lhs, float rhs)
+    {
+        return std::fabs(lhs - rhs) <= 1e-5F * (std::max)(1.0F, std::fabs(rhs));
+    }
+
+    // The batch kernels against scalar loops at sizes that leave every kind of tail after the 8 and 4 wide passes.
+    // The test binary is also built with -mavx2 and with LOT_NO_SIMD (see CMakeLists.txt) to cover each variant
+    void test_soa_simd_tail()
+    {
+        for (const std::size_t count : { std::size_t { 1 }, std::size_t { 3 }, std::size_t { 7 }, std::size_t { 9 }, std::size_t { 513 } })
+        {
+            std::vector<lot::point<float>> point_list(count);
+            for (std::size_t index = 0; index < count; ++index)
+                point_list[index] = { static_cast<float>(index % 17) - 8.5F, static_cast<float>(index % 5) * 1.25F + 3.0F };
+            // The only nearest point is the last one, which the scalar tail handles
+            point_list.back() = { 0.5F, 0.25F };
+
+            lot::point_soa<float> soa(point_list);
+            std::vector<float> distance_list(count);
+            soa.distance({ 0.5F, 0.0F }, distance_list);
+            bool is_distance_right = true;
+            for (std::size_t index = 0; index < count; ++index)
+                is_distance_right = is_distance_right && is_near(distance_list[index], std::hypot(point_list[index].data[0] - 0.5F, point_list[index].data[1]));
+            check(is_distance_right, "soa tail: wrong distance");
+            check(soa.nearest({ 0.5F, 0.0F }) == count - 1, "soa tail: wrong nearest");
+
+            soa.add({ 1.0F, -2.0F }).scale(0.5F);
+            bool is_transform_right = true;
+            for (std::size_t index = 0; index < count; ++index)
+            {
+                const auto value = soa.get(index);
+                is_transform_right = is_transform_right && value.data[0] == (point_list[index].data[0] + 1.0F) * 0.5F
+                    && value.data[1] == (point_list[index].data[1] - 2.0F) * 0.5F;
+            }
+            check(is_transform_right, "soa tail: wrong add or scale");
+        }
+    }
+
+    // Infinite distances still give a nearest point, NaN distances are skipped
+    void test_soa_nearest_non_finite()
+    {
+        constexpr float huge = std::numeric_limits<float>::max();
+        lot::point_soa<float> soa(std::vector<lot::point<float>> { { huge, huge }, { -huge, huge }, { huge, -huge } });
+        check(soa.nearest({ 0.0F, 0.0F }) == 0, "soa nearest: every distance is infinite");
+
+        constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+        lot::point_soa<float> nan_soa(std::vector<lot::point<float>> { { nan, 0.0F }, { huge, huge }, { nan, nan } });
+        check(nan_soa.nearest({ 0.0F, 0.0F }) == 1, "soa nearest: a NaN distance was taken");
+        nan_soa.set(1, { nan, 1.0F });
+        check(nan_soa.nearest({ 0.0F, 0.0F }) == nan_soa.size(), "soa nearest: every distance is NaN");
+    }
+
+
+    // A bulk build binned over several threads answers queries like a grid filled by insert
+    void test_uniform_grid_build()
+    {
+        std::vector<std::pair<std::uint32_t, lot::point<float>>> entry_list;
+        for (std::uint32_t index = 0; index < 40000; ++index)
+            entry_list.emplace_back(index * 7, lot::point<float> { static_cast<float>(index % 200) * 0.5F - 50.0F, static_cast<float>(index / 200) * 0.5F - 50.0F });
+
+        lot::uniform_grid<float, 2> built_grid(4.0F);
+        built_grid.build(entry_list, 4);
+        lot::uniform_grid<float, 2> inserted_grid(4.0F);
+        for (const auto& [id, position] : entry_list)
+            inserted_grid.insert(id, position);
+
+        auto query = [](const lot::uniform_grid<float, 2>& grid) {
+            std::vector<std::uint32_t> id_list;
+            grid.for_each_in_radius({ 3.0F, -7.5F }, 6.0F, [&](std::uint32_t id, const lot::point<float>& /*position*/) { id_list.push_back(id); });
+            std::sort(id_list.begin(), id_list.end());
+            return id_list;
+        };
+        const auto built_list = query(built_grid);
+        check(built_grid.size() == entry_list.size() && !built_list.empty() && built_list == query(inserted_grid), "uniform_grid: build differs from insert");
+
+        built_grid.move(7, { 100.0F, 100.0F });
+        check(built_grid.remove(0) && !built_grid.contains(0) && built_grid.get_position(7).data[0] == 100.0F, "uniform_grid: move or remove after build");
+    }
+
+
+    template <typename Func>
+    std::string runtime_error_message(Func&& func)
+    {
+        try {
+            func();
+        } catch (const std::runtime_error& error) {
+            return error.what();
+        }
+        return {};
+    }
+
+    // from_chars and from_string skip whitespace, reject trailing text and never read past the end of a view
+    void test_coordinate_parse()
+    {
+        check(lot::point<int>::from_string(" \t( 1 ,\n-2 )\r\n") == lot::point<int> { 1, -2 }, "coordinate parse: whitespace");
+        check(lot::point<double>::from_string("(0.5,-1e3)") == lot::point<double> { 0.5, -1000.0 }, "coordinate parse: floating values");
+        check(!runtime_error_message([] { (void)lot::point<int>::from_string("(1,2)x"); }).empty(), "coordinate parse: trailing text was accepted");
+        check(!runtime_error_message([] { (void)lot::point<int>::from_string("(1,2,3)"); }).empty(), "coordinate parse: too many values were accepted");
+
+        lot::point<int> value {};
+        const char text[] = "(1,2)x";
+        const auto result = lot::point<int>::from_chars(text, text + 6, value);
+        check(result.ec == std::errc {} && result.ptr == text + 5 && value == lot::point<int> { 1, 2 }, "coordinate parse: from_chars stops after ')'");
+
+        // Exactly sized heap buffers without a terminator, so reading past the view is caught by the sanitizers
+        const std::string_view source = "(12,34)";
+        for (std::size_t size = 0; size <= source.size(); ++size)
+        {
+            const auto buffer = std::make_unique<char[]>(size); // NOLINT(cppcoreguidelines-avoid-c-arrays)
+            std::memcpy(buffer.get(), source.data(), size);
+            const std::string_view view(buffer.get(), size);
+            const bool is_parsed = runtime_error_message([&] { value = lot::point<int>::from_string(view); }).empty();
+            check(is_parsed == (size == source.size()), "coordinate parse: a cut view");
+        }
+    }
+
+    // The coordinates before a bad one are kept and the error names its offset
+    void test_coordinate_list_parse()
+    {
+        std::vector<lot::point<int>> result;
+        lot::parse_coordinate_list<int, 2>("(1,2) (3,4);\n(5,6),", result);
+        check(result.size() == 3 && result[2] == lot::point<int> { 5, 6 }, "coordinate list: separators");
+
+        result.clear();
+        const auto message = runtime_error_message([&] { lot::parse_coordinate_list<int, 2>("(1,2) (3,4); (5,x) (7,8)", result); });
+        check(message.ends_with("offset 13") && result.size() == 2, "coordinate list: wrong error offset");
+
+        result.clear();
+        const std::string_view cut = std::string_view("(1,2) (3,4)").substr(0, 10);
+        check(!runtime_error_message([&] { lot::parse_coordinate_list<int, 2>(cut, result); }).empty() && result.size() == 1, "coordinate list: a cut view");
+    }
+
+
+    // The vector algebra is computed in accumulate_type, and distance and normalize are usable in constant expressions
+    void test_coordinate_algebra()
+    {
+        static_assert(lot::point<int> { 3, 4 }.distance() == 5.0);
+        static_assert(lot::point<double> { 1e150, 0.0 }.distance() == 1e150);
+        static_assert(lot::normalize(lot::point<double> { 0.0, -2.0 }) == lot::point<double> { 0.0, -1.0 });
+        static_assert(lot::normalize(lot::point<float> {}) == lot::point<float> {});
+        constexpr double root_two = lot::point<double> { 1.0, 1.0 }.distance();
+        check(std::fabs(root_two - std::sqrt(2.0)) <= std::numeric_limits<double>::epsilon() * 2, "coordinate algebra: constant evaluated distance");
+
+        constexpr lot::point<int> large { INT_MAX, INT_MAX };
+        check(lot::dot(large, large) == 2 * static_cast<std::int64_t>(INT_MAX) * INT_MAX, "coordinate algebra: dot overflowed");
+        check(lot::cross(large, lot::point<int> { INT_MIN, INT_MAX }) == static_cast<std::int64_t>(INT_MAX) * INT_MAX - static_cast<std::int64_t>(INT_MAX) * INT_MIN,
+            "coordinate algebra: 2D cross overflowed");
+        check(lot::cross(lot::tripoint<int> { 1, 0, 0 }, lot::tripoint<int> { 0, 1, 0 }) == lot::tripoint<std::int64_t> { 0, 0, 1 }, "coordinate algebra: 3D cross");
+        check(lot::cross(lot::point<double> { 1.0, 0.0 }, lot::point<double> { 0.0, 1.0 }) > 0, "coordinate algebra: counterclockwise cross");
+
+        // Unsigned axes must not wrap when `rhs` is larger
+        const lot::point<unsigned> lhs { 1, 10 };
+        const lot::point<unsigned> rhs { 5, 2 };
+        check(lot::manhattan_distance(lhs, rhs) == 12 && lot::manhattan_distance(rhs, lhs) == 12, "coordinate algebra: unsigned manhattan distance");
+        check(lot::chebyshev_distance(lhs, rhs) == 8 && lot::chebyshev_distance(rhs, lhs) == 8, "coordinate algebra: unsigned chebyshev distance");
+        const lot::tripoint<std::uint8_t> small_lhs { 0, 255, 7 };
+        const lot::tripoint<std::uint8_t> small_rhs { 255, 0, 7 };
+        check(lot::manhattan_distance(small_lhs, small_rhs) == 510 && lot::chebyshev_distance(small_lhs, small_rhs) == 255, "coordinate algebra: uint8_t distances");
+    }
+
+
+    template <typename Func>
+    bool throws_codec_error(Func&& func)
+    {
+        try {
+            func();
+        } catch (const lot::coordinate_codec_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    template <typename T>
+    void check_codec_round_trip(lot::coordinate_encoding encoding, const char* message)
+    {
+        std::vector<lot::point<T>> point_list;
+        for (int index = 0; index < 100; ++index)
+            point_list.push_back({ static_cast<T>(index * 3), static_cast<T>(index % 2 == 0 ? (std::numeric_limits<T>::max)() : (std::numeric_limits<T>::min)()) });
+        std::string buffer;
+        const auto block_size = lot::encode_coordinates<T, 2>(point_list, encoding, buffer);
+        std::vector<lot::point<T>> result;
+        check(lot::decode_coordinates<T, 2>(buffer.data(), buffer.size(), result) == block_size && result == point_list, message);
+    }
+
+    // Blocks round trip in both encodings and every damaged block throws instead of reading out of bounds
+    void test_coordinate_codec()
+    {
+        check_codec_round_trip<std::int32_t>(lot::coordinate_encoding::fixed, "codec: int32_t fixed round trip");
+        check_codec_round_trip<std::int32_t>(lot::coordinate_encoding::delta_varint, "codec: int32_t delta_varint round trip");
+        check_codec_round_trip<std::int64_t>(lot::coordinate_encoding::delta_varint, "codec: int64_t delta_varint round trip");
+        check_codec_round_trip<std::uint8_t>(lot::coordinate_encoding::delta_varint, "codec: uint8_t delta_varint round trip");
+        check_codec_round_trip<double>(lot::coordinate_encoding::fixed, "codec: double fixed round trip");
+
+        const std::vector<lot::point<std::int32_t>> point_list { { 1, 2 }, { -300, 70000 }, { 5, -5 } };
+        for (const auto encoding : { lot::coordinate_encoding::fixed, lot::coordinate_encoding::delta_varint })
+        {
+            std::string buffer;
+            const auto block_size = lot::encode_coordinates<std::int32_t, 2>(point_list, encoding, buffer);
+            lot::coordinate_block_header header;
+            std::memcpy(&header, buffer.data(), sizeof(header));
+            const std::size_t payload_end = sizeof(header) + lot::detail::little_endian(header).payload_size;
+
+            // Truncated blocks in exactly sized heap buffers, so a read past the end is caught by the sanitizers
+            std::vector<lot::point<std::int32_t>> result { { 9, 9 } };
+            bool is_truncation_rejected = true;
+            for (std::size_t size = 0; size < payload_end; ++size)
+            {
+                const auto cut = std::make_unique<char[]>(size); // NOLINT(cppcoreguidelines-avoid-c-arrays)
+                std::memcpy(cut.get(), buffer.data(), size);
+                is_truncation_rejected = is_truncation_rejected && throws_codec_error([&] { (void)lot::decode_coordinates<std::int32_t, 2>(cut.get(), size, result); });
+            }
+            check(is_truncation_rejected && result.size() == 1, "codec: a truncated block was accepted");
+
+            // A flipped bit either throws or decodes to at most the stored count, never crashes
+            bool is_bit_flip_safe = true;
+            for (std::size_t bit = 0; bit < block_size * 8; ++bit)
+            {
+                std::string damaged = buffer;
+                damaged[bit / 8] = static_cast<char>(damaged[bit / 8] ^ (1 << (bit % 8)));
+                result.clear();
+                const bool is_rejected = throws_codec_error([&] { (void)lot::decode_coordinates<std::int32_t, 2>(damaged.data(), damaged.size(), result); });
+                is_bit_flip_safe = is_bit_flip_safe && (is_rejected ? result.empty() : result.size() == point_list.size());
+            }
+            check(is_bit_flip_safe, "codec: a flipped bit was not handled");
+
+            std::vector<lot::point<std::uint32_t>> unsigned_result;
+            std::vector<lot::point<float>> float_result;
+            std::vector<lot::tripoint<std::int32_t>> tripoint_result;
+            check(throws_codec_error([&] { (void)lot::decode_coordinates<std::uint32_t, 2>(buffer.data(), buffer.size(), unsigned_result); })
+                    && throws_codec_error([&] { (void)lot::decode_coordinates<float, 2>(buffer.data(), buffer.size(), float_result); })
+                    && throws_codec_error([&] { (void)lot::decode_coordinates<std::int32_t, 3>(buffer.data(), buffer.size(), tripoint_result); }),
+                "codec: a block was decoded into another coordinate type");
+        }
+
+        // A fixed block is viewed in place when aligned, a misaligned copy must be decoded instead
+        std::string buffer;
+        lot::encode_coordinates<std::int32_t, 2>(point_list, lot::coordinate_encoding::fixed, buffer);
+        std::vector<std::uint64_t> aligned_storage(buffer.size() / sizeof(std::uint64_t) + 1);
+        auto* aligned = reinterpret_cast<char*>(aligned_storage.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        std::memcpy(aligned, buffer.data(), buffer.size());
+        const auto view = lot::view_coordinates<std::int32_t, 2>(aligned, buffer.size());
+        if constexpr (std::endian::native == std::endian::little)
+            check(view.has_value() && std::equal(view->begin(), view->end(), point_list.begin(), point_list.end()), "codec: view of an aligned block");
+        std::memmove(aligned + 1, aligned, buffer.size());
+        std::vector<lot::point<std::int32_t>> result;
+        check(!lot::view_coordinates<std::int32_t, 2>(aligned + 1, buffer.size()).has_value()
+                && lot::decode_coordinates<std::int32_t, 2>(aligned + 1, buffer.size(), result) != 0 && result == point_list,
+            "codec: a misaligned block");
+    }
+
+    // A delta_varint block of one 2D coordinate of T with a hand-written payload
+    template <typename T>
+    std::string make_varint_block(std::initializer_list<unsigned char> payload)
+    {
+        lot::coordinate_block_header header;
+        header.encoding = static_cast<std::uint8_t>(lot::coordinate_encoding::delta_varint);
+        header.value_kind = lot::detail::coordinate_value_kind<T>;
+        header.dimension = 2;
+        header.count = 1;
+        header.payload_size = static_cast<std::uint32_t>(payload.size());
+        header = lot::detail::little_endian(header);
+        std::string block(sizeof(header), '\0');
+        std::memcpy(block.data(), &header, sizeof(header));
+        block.append(payload.begin(), payload.end());
+        block.resize(lot::detail::align_block_size(block.size()));
+        return block;
+    }
+
+    // Varints longer than T needs or with bits above 64 are rejected, not silently cut
+    void test_coordinate_codec_varint()
+    {
+        auto decodes = [](const std::string& block, auto tag) {
+            std::vector<lot::point<decltype(tag)>> result;
+            return !throws_codec_error([&] { (void)lot::decode_coordinates<decltype(tag), 2>(block.data(), block.size(), result); });
+        };
+        const auto max_int64 = make_varint_block<std::int64_t>({ 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00 });
+        check(decodes(max_int64, std::int64_t {}), "codec varint: a 64-bit zigzag value");
+        check(!decodes(make_varint_block<std::int64_t>({ 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x00 }), std::int64_t {}),
+            "codec varint: bits above 2^64");
+        check(!decodes(make_varint_block<std::int32_t>({ 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0x00 }), std::int32_t {}), "codec varint: longer than an int32_t needs");
+        check(!decodes(make_varint_block<std::int32_t>({ 0xFF, 0xFF, 0xFF, 0xFF, 0x1F, 0x00 }), std::int32_t {}), "codec varint: wider than an int32_t");
+        check(decodes(make_varint_block<std::int32_t>({ 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 0x00 }), std::int32_t {}), "codec varint: the widest int32_t zigzag value");
+    }
+
+} // namespace
+
+int main()
+{
+    test_dynamic_command_allocation();
+    test_static_schema_command_allocation();
+    test_incremental_renderer_dirty_region();
+    test_snapshot_addition_type();
+    test_snapshot_overflow();
+    test_shared_registry();
+    test_completion_output();
+    test_argument_file_loader();
+    test_option_scope();
+    test_soa_simd_tail();
+    test_soa_nearest_non_finite();
+    test_uniform_grid_build();
+    test_coordinate_parse();
+    test_coordinate_list_parse();
+    test_coordinate_algebra();
+    test_coordinate_codec();
+    test_coordinate_codec_varint();
+
+    if (failure_count != 0)
+        return EXIT_FAILURE;
+    std::puts("all tests passed");
+    return EXIT_SUCCESS;
+}
\ No newline at end of file